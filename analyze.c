@@ -0,0 +1,66 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cfg.h"
+#include "chip8.h"
+
+// standalone rom analyzer: prints the disassembly split in basic blocks and
+// optionally writes the block map for execution engines to load
+int main(int argc, char *argv[]) {
+  char *rom_path = NULL;
+  char *map_path = NULL;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      map_path = argv[++i];
+    } else {
+      rom_path = argv[i];
+    }
+  }
+
+  if (rom_path == NULL) {
+    printf("usage: %s <rom> [-o block map]\n", argv[0]);
+    return 1;
+  }
+
+  FILE *rom_file = fopen(rom_path, "rb");
+  if (rom_file == NULL) {
+    printf("error while opening file\n");
+    return 1;
+  }
+
+  uint8_t rom[MEMSIZE];
+  size_t size = fread(rom, 1, sizeof(rom), rom_file);
+  fclose(rom_file);
+
+  Cfg *cfg = malloc(sizeof(Cfg));
+  if (cfg == NULL) {
+    printf("error while allocating analysis memory\n");
+    return 1;
+  }
+
+  if (!cfg_analyze(cfg, rom, size)) {
+    printf("could not analyze the rom\n");
+    free(cfg);
+    return 1;
+  }
+
+  cfg_print(cfg, stdout);
+
+  if (map_path != NULL) {
+    FILE *map_file = fopen(map_path, "w");
+    if (map_file == NULL) {
+      printf("could not open %s\n", map_path);
+      free(cfg);
+      return 1;
+    }
+
+    cfg_write_block_map(cfg, map_file);
+    fclose(map_file);
+  }
+
+  free(cfg);
+  return 0;
+}
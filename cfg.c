@@ -0,0 +1,477 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cfg.h"
+#include "chip8.h"
+#include "disasm.h"
+
+// mirrors the cases execute_cycle acts on, everything else is a no-op there
+static bool is_known_instruction(Instruction in) {
+  switch (in.type) {
+  case 0x0:
+    return in.nn == 0xE0 || in.nn == 0xEE;
+  case 0x8:
+    return in.n <= 0x7 || in.n == 0xE;
+  case 0xE:
+    return in.nn == 0x9E || in.nn == 0xA1;
+  case 0xF:
+    switch (in.nn) {
+    case 0x07:
+    case 0x0A:
+    case 0x15:
+    case 0x18:
+    case 0x1E:
+    case 0x29:
+    case 0x33:
+    case 0x55:
+    case 0x65:
+      return true;
+    default:
+      return false;
+    }
+  default:
+    return true;
+  }
+}
+
+// returns -1 when the instruction falls through to the next one, otherwise
+// it ends a block and the amount of successors written is returned
+static int instruction_successors(uint16_t address, Instruction in,
+                                  uint16_t successors[2], uint8_t *flags) {
+  uint16_t next = address + 2;
+
+  switch (in.type) {
+  case 0x0:
+    if (in.nn == 0xEE) {
+      *flags |= BLOCK_RETURN;
+      return 0;
+    }
+    return -1;
+  case 0x1:
+    if (in.nnn == address) {
+      *flags |= BLOCK_HALT;
+    }
+    successors[0] = in.nnn;
+    return 1;
+  case 0x2:
+    successors[0] = in.nnn;
+    successors[1] = next;
+    return 2;
+  case 0x3:
+  case 0x4:
+  case 0x5:
+  case 0x9:
+    successors[0] = next;
+    successors[1] = next + 2;
+    return 2;
+  case 0xB:
+    *flags |= BLOCK_INDIRECT;
+    return 0;
+  case 0xE:
+    if (in.nn == 0x9E || in.nn == 0xA1) {
+      successors[0] = next;
+      successors[1] = next + 2;
+      return 2;
+    }
+    return -1;
+  default:
+    return -1;
+  }
+}
+
+// instructions a wait loop may contain: compares, register moves and reads
+// of the delay timer or keys. nothing that draws, writes memory or calls.
+static bool is_wait_instruction(Instruction in, bool *reads_input) {
+  switch (in.type) {
+  case 0x3:
+  case 0x4:
+  case 0x5:
+  case 0x6:
+  case 0x7:
+  case 0x8:
+  case 0x9:
+    return true;
+  case 0xE:
+    *reads_input = true;
+    return in.nn == 0x9E || in.nn == 0xA1;
+  case 0xF:
+    *reads_input = true;
+    return in.nn == 0x07 || in.nn == 0x0A;
+  default:
+    return false;
+  }
+}
+
+static Instruction instruction_at(Cfg *cfg, uint16_t address) {
+  return decode_instruction((cfg->image[address] << 8) |
+                            cfg->image[address + 1]);
+}
+
+static bool in_rom(Cfg *cfg, uint16_t address) {
+  return address >= PROGRAM_START &&
+         address + 1 < PROGRAM_START + cfg->rom_size;
+}
+
+static void explore(Cfg *cfg, bool *subroutine) {
+  uint16_t work[MEMSIZE * 2];
+  int work_count = 0;
+
+  work[work_count++] = PROGRAM_START;
+  cfg->leader[PROGRAM_START] = true;
+
+  while (work_count > 0) {
+    uint16_t address = work[--work_count];
+
+    while (in_rom(cfg, address) && !cfg->instruction_start[address]) {
+      cfg->instruction_start[address] = true;
+      cfg->kind[address] = BYTE_CODE;
+      cfg->kind[address + 1] = BYTE_CODE;
+
+      Instruction in = instruction_at(cfg, address);
+      uint16_t successors[2];
+      uint8_t flags = 0;
+      int count = instruction_successors(address, in, successors, &flags);
+
+      if (in.type == 0x2) {
+        subroutine[in.nnn] = true;
+      }
+
+      if (count == -1) {
+        address += 2;
+        continue;
+      }
+
+      for (int i = 0; i < count; ++i) {
+        if (!in_rom(cfg, successors[i])) {
+          continue;
+        }
+
+        cfg->leader[successors[i]] = true;
+        if (!cfg->instruction_start[successors[i]]) {
+          work[work_count++] = successors[i];
+        }
+      }
+
+      break;
+    }
+  }
+}
+
+static bool build_blocks(Cfg *cfg, const bool *subroutine) {
+  BasicBlock *block = NULL;
+
+  for (int address = PROGRAM_START; address < MEMSIZE; ++address) {
+    if (!cfg->instruction_start[address]) {
+      continue;
+    }
+
+    // the open block falls through to its end. an instruction starting
+    // inside its last opcode comes from an overlapping decode, which splits
+    // the block without removing that edge.
+    if (block != NULL && (cfg->leader[address] || address != block->end)) {
+      block->successors[0] = block->end;
+      block->successors_count = 1;
+      if (address != block->end) {
+        block->flags |= BLOCK_OVERLAP;
+      }
+      block = NULL;
+    }
+
+    if (block == NULL) {
+      if (cfg->blocks_count >= MAX_BLOCKS) {
+        return false;
+      }
+
+      block = &cfg->blocks[cfg->blocks_count++];
+      memset(block, 0, sizeof(BasicBlock));
+      block->start = address;
+      if (subroutine[address]) {
+        block->flags |= BLOCK_SUBROUTINE;
+      }
+    }
+
+    Instruction in = instruction_at(cfg, address);
+    block->end = address + 2;
+    if (!is_known_instruction(in)) {
+      block->flags |= BLOCK_INVALID;
+    }
+
+    int count =
+        instruction_successors(address, in, block->successors, &block->flags);
+    if (count != -1) {
+      block->successors_count = count;
+      block = NULL;
+    } else if (!in_rom(cfg, block->end)) {
+      // falls off the end of the rom into empty memory
+      block->flags |= BLOCK_INVALID;
+      block = NULL;
+    }
+  }
+
+  return true;
+}
+
+// a 1NNN jumping back over straight line code that only polls timers or
+// keys is a loop where the program waits for something external
+static void find_idle_loops(Cfg *cfg) {
+  for (int i = 0; i < cfg->blocks_count; ++i) {
+    BasicBlock *block = &cfg->blocks[i];
+    uint16_t jump = block->end - 2;
+    Instruction in = instruction_at(cfg, jump);
+
+    if (in.type != 0x1 || in.nnn > jump || !in_rom(cfg, in.nnn)) {
+      continue;
+    }
+
+    bool idle = true;
+    bool reads_input = false;
+    for (uint16_t address = in.nnn; address < jump && idle; address += 2) {
+      idle = cfg->instruction_start[address] &&
+             is_wait_instruction(instruction_at(cfg, address), &reads_input);
+    }
+
+    BasicBlock *target = cfg_find_block(cfg, in.nnn);
+    if (idle && (reads_input || in.nnn == jump) && target != NULL) {
+      target->flags |= BLOCK_IDLE_LOOP;
+    }
+  }
+}
+
+// bytes never reached as code are data. runs starting at an ANNN target are
+// marked as such, leading bytes nobody points to stay unknown.
+static void classify_data(Cfg *cfg) {
+  bool referenced[MEMSIZE] = {0};
+  for (int address = PROGRAM_START; address < MEMSIZE; ++address) {
+    if (cfg->instruction_start[address]) {
+      Instruction in = instruction_at(cfg, address);
+      if (in.type == 0xA) {
+        referenced[in.nnn] = true;
+      }
+    }
+  }
+
+  bool in_data = false;
+  for (int address = PROGRAM_START; address < PROGRAM_START + cfg->rom_size;
+       ++address) {
+    if (cfg->kind[address] == BYTE_CODE) {
+      in_data = false;
+      continue;
+    }
+
+    in_data = in_data || referenced[address];
+    cfg->kind[address] = in_data ? BYTE_DATA : BYTE_UNKNOWN;
+  }
+}
+
+bool cfg_analyze(Cfg *cfg, const uint8_t *rom, size_t size) {
+  if (size > MEMSIZE - PROGRAM_START) {
+    return false;
+  }
+
+  memset(cfg, 0, sizeof(Cfg));
+  memcpy(cfg->image + PROGRAM_START, rom, size);
+  cfg->rom_size = size;
+
+  bool subroutine[MEMSIZE] = {0};
+  explore(cfg, subroutine);
+  if (!build_blocks(cfg, subroutine)) {
+    return false;
+  }
+  find_idle_loops(cfg);
+  classify_data(cfg);
+
+  return true;
+}
+
+BasicBlock *cfg_find_block(Cfg *cfg, uint16_t address) {
+  int low = 0;
+  int high = cfg->blocks_count - 1;
+
+  while (low <= high) {
+    int middle = (low + high) / 2;
+    BasicBlock *block = &cfg->blocks[middle];
+    if (address < block->start) {
+      high = middle - 1;
+    } else if (address >= block->end) {
+      low = middle + 1;
+    } else {
+      return block;
+    }
+  }
+
+  return NULL;
+}
+
+static void print_flags(uint8_t flags, FILE *out) {
+  static const char *names[] = {"subroutine", "idle-loop", "halt",
+                                "indirect",   "return",    "invalid",
+                                "overlap"};
+
+  for (int i = 0; i < 7; ++i) {
+    if (flags & (1 << i)) {
+      fprintf(out, " %s", names[i]);
+    }
+  }
+}
+
+static void print_data(Cfg *cfg, uint16_t start, uint16_t end, FILE *out) {
+  fprintf(out, "%s 0x%03X-0x%03X (%d bytes)\n",
+          cfg->kind[start] == BYTE_DATA ? "data" : "unknown", start, end,
+          end - start);
+}
+
+void cfg_print(Cfg *cfg, FILE *out) {
+  int subroutines = 0;
+  int idle_loops = 0;
+  for (int i = 0; i < cfg->blocks_count; ++i) {
+    subroutines += (cfg->blocks[i].flags & BLOCK_SUBROUTINE) != 0;
+    idle_loops += (cfg->blocks[i].flags & (BLOCK_IDLE_LOOP | BLOCK_HALT)) != 0;
+  }
+
+  fprintf(out, "rom: %d bytes, %d blocks, %d subroutines, %d idle loops\n",
+          cfg->rom_size, cfg->blocks_count, subroutines, idle_loops);
+
+  int end = PROGRAM_START + cfg->rom_size;
+  int address = PROGRAM_START;
+  int block_index = 0;
+  char text[32];
+
+  while (address < end) {
+    // blocks decoded at odd offsets can overlap the previous one
+    while (block_index < cfg->blocks_count &&
+           cfg->blocks[block_index].start < address) {
+      ++block_index;
+    }
+
+    BasicBlock *block =
+        block_index < cfg->blocks_count ? &cfg->blocks[block_index] : NULL;
+
+    if (block != NULL && block->start == address) {
+      fprintf(out, "\nblock 0x%03X-0x%03X ->", block->start, block->end);
+      for (int i = 0; i < block->successors_count; ++i) {
+        fprintf(out, " 0x%03X", block->successors[i]);
+      }
+      print_flags(block->flags, out);
+      fprintf(out, "\n");
+
+      for (uint16_t pc = block->start; pc < block->end; pc += 2) {
+        uint16_t op_code = (cfg->image[pc] << 8) | cfg->image[pc + 1];
+        fprintf(out, "  0x%03X  %04X  %s\n", pc, op_code,
+                disassemble(op_code, text, sizeof(text)));
+      }
+
+      address = block->end;
+      ++block_index;
+      continue;
+    }
+
+    // data runs up to the next block or the next change of kind
+    int data_end = address + 1;
+    int limit = block != NULL ? block->start : end;
+    while (data_end < limit && cfg->kind[data_end] == cfg->kind[address]) {
+      ++data_end;
+    }
+
+    fprintf(out, "\n");
+    print_data(cfg, address, data_end, out);
+    address = data_end;
+  }
+}
+
+// format:
+//   chip8-block-map <version>
+//   rom <size>
+//   block <start> <end> <flags> <successors count> [successor...]
+//   data <start> <end>
+// addresses and flags are hex, end addresses are exclusive.
+void cfg_write_block_map(Cfg *cfg, FILE *out) {
+  fprintf(out, "chip8-block-map %d\n", BLOCK_MAP_VERSION);
+  fprintf(out, "rom %d\n", cfg->rom_size);
+
+  for (int i = 0; i < cfg->blocks_count; ++i) {
+    BasicBlock *block = &cfg->blocks[i];
+    fprintf(out, "block %03X %03X %02X %d", block->start, block->end,
+            block->flags, block->successors_count);
+    for (int j = 0; j < block->successors_count; ++j) {
+      fprintf(out, " %03X", block->successors[j]);
+    }
+    fprintf(out, "\n");
+  }
+
+  int end = PROGRAM_START + cfg->rom_size;
+  for (int address = PROGRAM_START; address < end;) {
+    if (cfg->kind[address] != BYTE_DATA) {
+      ++address;
+      continue;
+    }
+
+    int data_end = address;
+    while (data_end < end && cfg->kind[data_end] == BYTE_DATA) {
+      ++data_end;
+    }
+
+    fprintf(out, "data %03X %03X\n", address, data_end);
+    address = data_end;
+  }
+}
+
+// loads blocks and byte kinds, the rom image itself is not part of the map
+bool cfg_read_block_map(Cfg *cfg, FILE *in) {
+  memset(cfg, 0, sizeof(Cfg));
+
+  int version;
+  int rom_size;
+  if (fscanf(in, "chip8-block-map %d\nrom %d\n", &version, &rom_size) != 2 ||
+      version != BLOCK_MAP_VERSION || rom_size < 0 ||
+      rom_size > MEMSIZE - PROGRAM_START) {
+    return false;
+  }
+  cfg->rom_size = rom_size;
+
+  char kind[8];
+  while (fscanf(in, "%7s", kind) == 1) {
+    unsigned int start;
+    unsigned int end;
+
+    if (strcmp(kind, "block") == 0) {
+      unsigned int flags;
+      int count;
+      if (fscanf(in, "%x %x %x %d", &start, &end, &flags, &count) != 4 ||
+          count < 0 || count > 2 || cfg->blocks_count >= MAX_BLOCKS ||
+          start >= end || end > MEMSIZE) {
+        return false;
+      }
+
+      BasicBlock *block = &cfg->blocks[cfg->blocks_count++];
+      block->start = start;
+      block->end = end;
+      block->flags = flags;
+      block->successors_count = count;
+      for (int i = 0; i < count; ++i) {
+        unsigned int successor;
+        if (fscanf(in, "%x", &successor) != 1) {
+          return false;
+        }
+        block->successors[i] = successor;
+      }
+
+      memset(cfg->kind + start, BYTE_CODE, end - start);
+      cfg->leader[start] = true;
+      for (unsigned int pc = start; pc < end; pc += 2) {
+        cfg->instruction_start[pc] = true;
+      }
+    } else if (strcmp(kind, "data") == 0) {
+      if (fscanf(in, "%x %x", &start, &end) != 2 || start >= end ||
+          end > MEMSIZE) {
+        return false;
+      }
+
+      memset(cfg->kind + start, BYTE_DATA, end - start);
+    } else {
+      return false;
+    }
+  }
+
+  return true;
+}
@@ -0,0 +1,57 @@
+#ifndef CFG_H
+#define CFG_H
+
+#include "chip8.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// a block starts on an instruction, and instructions can start on odd
+// addresses as well as even ones
+#define MAX_BLOCKS MEMSIZE
+#define BLOCK_MAP_VERSION 1
+
+// what the analysis found for a byte of the rom
+typedef enum byte_kind {
+  BYTE_UNKNOWN, // never reached, assumed to be data
+  BYTE_CODE,
+  BYTE_DATA, // pointed to by an ANNN, most likely sprites
+} ByteKind;
+
+// block flags
+#define BLOCK_SUBROUTINE 0x01 // entry of a 2NNN target
+#define BLOCK_IDLE_LOOP 0x02  // start of a loop only waiting on timers or keys
+#define BLOCK_HALT 0x04       // ends with a 1NNN jumping to itself
+#define BLOCK_INDIRECT 0x08   // ends with BNNN, successors are unknown
+#define BLOCK_RETURN 0x10     // ends with 00EE
+#define BLOCK_INVALID 0x20    // runs into an opcode execute_cycle ignores
+#define BLOCK_OVERLAP 0x40    // code decoded from inside its last opcode
+
+// straight line code between start (inclusive) and end (exclusive)
+typedef struct basic_block {
+  uint16_t start;
+  uint16_t end;
+  uint16_t successors[2];
+  uint8_t successors_count;
+  uint8_t flags;
+} BasicBlock;
+
+typedef struct cfg {
+  uint8_t image[MEMSIZE];
+  uint16_t rom_size;
+  uint8_t kind[MEMSIZE];
+  bool instruction_start[MEMSIZE];
+  bool leader[MEMSIZE];
+  int blocks_count;
+  BasicBlock blocks[MAX_BLOCKS];
+} Cfg;
+
+bool cfg_analyze(Cfg *cfg, const uint8_t *rom, size_t size);
+BasicBlock *cfg_find_block(Cfg *cfg, uint16_t address);
+void cfg_print(Cfg *cfg, FILE *out);
+
+// the block map is a line based text file, see cfg_write_block_map
+void cfg_write_block_map(Cfg *cfg, FILE *out);
+bool cfg_read_block_map(Cfg *cfg, FILE *in);
+
+#endif // !CFG_H
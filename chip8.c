@@ -0,0 +1,831 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "stack.h"
+
+bool legacy_mode = true;
+int cpu_frequency = CPU_FREQUENCY;
+TimingProfile timing_profile = TIMING_MODERN;
+bool display_wait = false;
+bool screen_state[SCREEN_H][SCREEN_W] = {0};
+uint64_t screen_rows[SCREEN_H] = {0};
+const uint8_t fonts[FONTSET_SIZE] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80  // F
+};
+
+uint8_t memory[MEMSIZE];
+int16_t program_counter;
+int16_t index_register;
+uint8_t v[16];
+Stack functions_stack;
+uint8_t delay_timer;
+uint8_t audio_timer;
+uint16_t keyboard;
+bool key_waiting;
+uint8_t key_wait_register;
+uint16_t key_wait_pressed;
+
+uint64_t memory_hash;
+uint64_t screen_hash;
+bool self_jump;
+bool faulted;
+uint64_t random_state;
+int cycle_remainder;
+int instruction_cycles;
+void (*memory_write_hook)(uint16_t address, uint8_t value) = NULL;
+bool (*cycle_hook)() = NULL;
+
+static bool frame_interrupted = false; // cycle_hook stopped the last frame
+
+// splitmix64 finalizer, spreads every input bit over the whole output
+uint64_t mix_hash(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xBF58476D1CE4E5B9ULL;
+  x ^= x >> 27;
+  x *= 0x94D049BB133111EBULL;
+  x ^= x >> 31;
+
+  return x;
+}
+
+static uint64_t memory_cell_hash(uint16_t address, uint8_t value) {
+  return mix_hash(((uint64_t)address << 8) | value);
+}
+
+// a pixel that is on contributes its hash, so a blank screen hashes to 0
+static uint64_t pixel_hash(int x, int y) {
+  return mix_hash(0x10000000ULL | (y * SCREEN_W + x));
+}
+
+// every memory write goes through here to keep memory_hash up to date
+static void write_memory(uint16_t address, uint8_t value) {
+  if (memory_write_hook) {
+    memory_write_hook(address, value);
+  }
+
+  memory_hash ^= memory_cell_hash(address, memory[address]) ^
+                 memory_cell_hash(address, value);
+  memory[address] = value;
+}
+
+// recompute the incremental hashes and screen_rows from scratch
+void rehash_machine() {
+  memory_hash = 0;
+  for (int i = 0; i < MEMSIZE; ++i) {
+    memory_hash ^= memory_cell_hash(i, memory[i]);
+  }
+
+  screen_hash = 0;
+  for (int i = 0; i < SCREEN_H; ++i) {
+    screen_rows[i] = 0;
+    for (int j = 0; j < SCREEN_W; ++j) {
+      screen_rows[i] = (screen_rows[i] << 1) | screen_state[i][j];
+      if (screen_state[i][j]) {
+        screen_hash ^= pixel_hash(j, i);
+      }
+    }
+  }
+}
+
+// hash of the whole machine state. memory and screen are tracked
+// incrementally, the rest is small enough to fold in on every call.
+uint64_t machine_state_hash() {
+  uint64_t hash = memory_hash ^ mix_hash(screen_hash);
+  hash = mix_hash(hash ^ (uint16_t)program_counter);
+  hash = mix_hash(hash ^ ((uint64_t)(uint16_t)index_register << 16) ^
+                  ((uint64_t)delay_timer << 32) ^
+                  ((uint64_t)audio_timer << 40) ^ ((uint64_t)faulted << 48));
+
+  uint64_t registers[2];
+  memcpy(registers, v, sizeof(v));
+  hash = mix_hash(hash ^ registers[0]);
+  hash = mix_hash(hash ^ registers[1]);
+
+  uint64_t keys = keyboard | ((uint64_t)key_wait_pressed << 16) |
+                  ((uint64_t)key_waiting << 32) |
+                  ((uint64_t)key_wait_register << 40);
+  hash = mix_hash(hash ^ keys);
+  hash = mix_hash(hash ^ (uint64_t)(functions_stack.head + 1));
+
+  for (int i = 0; i <= functions_stack.head; ++i) {
+    hash = mix_hash(hash ^ (uint16_t)functions_stack.data[i]);
+  }
+
+  hash = mix_hash(hash ^ random_state);
+  hash = mix_hash(hash ^ (uint32_t)cycle_remainder);
+
+  return hash;
+}
+
+// power on state without a program, the fonts are loaded
+void reset_machine() {
+  seed_random(time(NULL));
+  memset(memory, 0, MEMSIZE);
+  memset(v, 0, 16);
+  keyboard = 0;
+  key_waiting = false;
+  key_wait_register = 0;
+  key_wait_pressed = 0;
+  memset(screen_state, 0, sizeof(screen_state));
+  memset(screen_rows, 0, sizeof(screen_rows));
+  stack_init(&functions_stack, 128);
+  index_register = 0;
+  delay_timer = 0;
+  audio_timer = 0;
+  self_jump = false;
+  faulted = false;
+  cycle_remainder = 0;
+  frame_interrupted = false;
+
+  memcpy(memory + FONT_MEMORY_LOCATION, fonts,
+         FONTSET_SIZE); // copy fonts into mem
+  program_counter = PROGRAM_START;
+  rehash_machine();
+}
+
+bool init_emulator(char *rom_name) {
+  reset_machine();
+
+  bool loaded =
+      load_program(rom_name != NULL ? rom_name : "roms/IBM_Logo.ch8");
+  rehash_machine();
+
+  return loaded;
+}
+
+// approximate cosmac vip machine cycles, fetch and decode included. skips
+// cost a little more when taken, draws and memory copies grow with their size.
+static int vip_cost(Instruction in, bool skipped) {
+  int skip = skipped ? 4 : 0;
+
+  switch (in.type) {
+  case 0x0:
+    return in.nn == 0xE0 ? 720 : 50;
+  case 0x1:
+    return 52;
+  case 0x2:
+    return 66;
+  case 0x3:
+  case 0x4:
+    return 46 + skip;
+  case 0x5:
+  case 0x9:
+    return 52 + skip;
+  case 0x6:
+    return 34;
+  case 0x7:
+    return 42;
+  case 0x8:
+    return 88;
+  case 0xA:
+    return 44;
+  case 0xB:
+    return 64;
+  case 0xC:
+    return 80;
+  case 0xD:
+    return 92 + 108 * in.n;
+  case 0xE:
+    return 56 + skip;
+  default:
+    break;
+  }
+
+  switch (in.nn) {
+  case 0x1E:
+    return 54;
+  case 0x29:
+    return 58;
+  case 0x33:
+    return 180;
+  case 0x55:
+  case 0x65:
+    return 50 + 28 * (in.x + 1);
+  default:
+    return 46;
+  }
+}
+
+int instruction_cost(Instruction instruction, bool skipped) {
+  if (timing_profile == TIMING_VIP) {
+    return vip_cost(instruction, skipped);
+  }
+
+  // cpu_frequency of these fit in the TIMER_FREQUENCY budgets of a second
+  return TIMER_FREQUENCY;
+}
+
+// run one 60hz frame: instructions are executed while the frame budget
+// lasts, and the one that overdraws it is paid by the next frame. everything
+// is counted in integers so a frame always executes the same instructions
+// for a given history. returns true when the screen changed.
+bool run_frame() {
+  bool screen_changed = false;
+
+  if (!frame_interrupted) {
+    cycle_remainder +=
+        timing_profile == TIMING_VIP ? VIP_FRAME_CYCLES : cpu_frequency;
+  }
+  frame_interrupted = false;
+
+  while (cycle_remainder > 0 && !key_waiting && !faulted) {
+    if (cycle_hook && cycle_hook()) {
+      frame_interrupted = true;
+      return screen_changed;
+    }
+
+    bool drawn = (memory[program_counter] & 0xF0) == 0xD0;
+    if (execute_cycle()) {
+      screen_changed = true;
+    }
+    cycle_remainder -= instruction_cycles;
+
+    // the vip draws after waiting for the display interrupt, the rest of the
+    // frame is spent idle
+    if (display_wait && drawn) {
+      break;
+    }
+  }
+
+  // a machine parked on FX0A, faulted or waiting for the display does not
+  // carry the unused cycles over
+  if (cycle_remainder > 0) {
+    cycle_remainder = 0;
+  }
+
+  tick_timers();
+  return screen_changed;
+}
+
+// every change of the keys goes through here. FX0A completes on the release
+// of a key that was pressed during the wait, like on the cosmac vip.
+void set_keys(uint16_t keys) {
+  if (key_waiting) {
+    key_wait_pressed |= keys & ~keyboard;
+
+    uint16_t released = key_wait_pressed & ~keys;
+    for (int key = 0; key < 16 && released; ++key) {
+      if ((released >> key) & 1) {
+        v[key_wait_register] = key;
+        program_counter += 2;
+        key_waiting = false;
+        break;
+      }
+    }
+  }
+
+  keyboard = keys;
+}
+
+void seed_random(uint64_t seed) {
+  // xorshift must never be all zeros
+  random_state = mix_hash(seed) | 1;
+}
+
+// xorshift64*, kept in the machine state so runs can be replayed exactly
+static uint32_t next_random() {
+  random_state ^= random_state >> 12;
+  random_state ^= random_state << 25;
+  random_state ^= random_state >> 27;
+
+  return (random_state * 0x2545F4914F6CDD1DULL) >> 32;
+}
+
+void save_machine(MachineState *state) {
+  memcpy(state->memory, memory, sizeof(memory));
+  memcpy(state->screen_state, screen_state, sizeof(screen_state));
+  memcpy(state->screen_rows, screen_rows, sizeof(screen_rows));
+  state->program_counter = program_counter;
+  state->index_register = index_register;
+  memcpy(state->v, v, sizeof(v));
+  state->functions_stack = functions_stack;
+  state->delay_timer = delay_timer;
+  state->audio_timer = audio_timer;
+  state->keyboard = keyboard;
+  state->key_waiting = key_waiting;
+  state->key_wait_register = key_wait_register;
+  state->key_wait_pressed = key_wait_pressed;
+  state->memory_hash = memory_hash;
+  state->screen_hash = screen_hash;
+  state->self_jump = self_jump;
+  state->faulted = faulted;
+  state->random_state = random_state;
+  state->cycle_remainder = cycle_remainder;
+}
+
+void load_machine(const MachineState *state) {
+  memcpy(memory, state->memory, sizeof(memory));
+  memcpy(screen_state, state->screen_state, sizeof(screen_state));
+  memcpy(screen_rows, state->screen_rows, sizeof(screen_rows));
+  program_counter = state->program_counter;
+  index_register = state->index_register;
+  memcpy(v, state->v, sizeof(v));
+  functions_stack = state->functions_stack;
+  delay_timer = state->delay_timer;
+  audio_timer = state->audio_timer;
+  keyboard = state->keyboard;
+  key_waiting = state->key_waiting;
+  key_wait_register = state->key_wait_register;
+  key_wait_pressed = state->key_wait_pressed;
+  memory_hash = state->memory_hash;
+  screen_hash = state->screen_hash;
+  self_jump = state->self_jump;
+  faulted = state->faulted;
+  random_state = state->random_state;
+  cycle_remainder = state->cycle_remainder;
+}
+
+// decrement both timers, must be called at TIMER_FREQUENCY
+void tick_timers() {
+  if (delay_timer > 0) {
+    --delay_timer;
+  }
+
+  if (audio_timer > 0) {
+    --audio_timer;
+  }
+}
+
+bool load_program(char *program_file_path) {
+  FILE *program_file = fopen(program_file_path, "rb");
+  if (program_file == NULL) {
+    printf("error while opening file\n");
+    return false;
+  }
+
+  fseek(program_file, 0, SEEK_END);
+  long fsize = ftell(program_file);
+  fseek(program_file, 0, SEEK_SET);
+
+  if (fsize == -1) {
+    printf("error while reading the file size\n");
+    fclose(program_file);
+    return false;
+  }
+
+  if (fsize > MEMSIZE - PROGRAM_START) {
+    printf("the program does not fit in memory (%ld bytes, max %d)\n", fsize,
+           MEMSIZE - PROGRAM_START);
+    fclose(program_file);
+    return false;
+  }
+
+  // read straight into the program area, no intermediate copy
+  fread(memory + PROGRAM_START, fsize, 1, program_file);
+  int res = ferror(program_file);
+  fclose(program_file);
+
+  if (res != 0) {
+    printf("error while reading the file\n");
+    return false;
+  }
+
+  return true;
+}
+
+uint8_t *byte_to_bits(const uint8_t byte, uint8_t *bits_arr) {
+  uint8_t mask = 0x80;
+
+  for (int i = 0; i < 8; ++i) {
+    bits_arr[i] = (byte & mask) != 0;
+    mask >>= 1;
+  }
+
+  return bits_arr;
+}
+
+// run fetch, decode and execute
+bool execute_cycle() {
+  if (key_waiting || faulted) {
+    return false;
+  }
+
+  bool should_update_screen = false;
+  uint16_t op_code = ((uint8_t)memory[program_counter] << 8) |
+                     (uint8_t)memory[program_counter + 1];
+
+  program_counter += 2;
+  int16_t next_instruction = program_counter;
+
+  Instruction instruction = decode_instruction(op_code);
+  uint8_t op_type = instruction.type;
+  uint8_t x = instruction.x;
+  uint8_t y = instruction.y;
+  uint8_t n = instruction.n;
+  uint8_t nn = instruction.nn;
+  uint16_t nnn = instruction.nnn;
+
+  switch (op_type) {
+  case 0x0:
+    if (nn == 0xE0) {
+      op_clear_screen();
+      should_update_screen = true;
+    } else if (nn == 0xEE) {
+      op_return_subroutine();
+    }
+    break;
+  case 0x1:
+    if (nnn == program_counter - 2) {
+      self_jump = true; // nothing can ever leave this loop
+    }
+    op_jump(nnn);
+    break;
+  case 0x2:
+    op_call_subroutine(nnn);
+    break;
+  case 0x3:
+    op_skip_eq_reg_num(x, nn);
+    break;
+  case 0x4:
+    op_skip_not_eq_reg_num(x, nn);
+    break;
+  case 0x5:
+    op_skip_eq_reg(x, y);
+    break;
+  case 0x6:
+    op_set_register(x, nn);
+    break;
+  case 0x7:
+    op_add_to_register(x, nn);
+    break;
+  case 0x8:
+    switch (n) {
+    case 0x0:
+      op_set(x, y);
+      break;
+    case 0x1:
+      op_binary_or(x, y);
+      break;
+    case 0x2:
+      op_binary_and(x, y);
+      break;
+    case 0x3:
+      op_binary_xor(x, y);
+      break;
+    case 0x4:
+      op_add_registers(x, y);
+      break;
+    case 0x5:
+      op_vx_minus_vy(x, y);
+      break;
+    case 0x6:
+      op_shift_right(x, y);
+      break;
+    case 0x7:
+      op_vy_minus_vx(x, y);
+      break;
+    case 0xE:
+      op_shift_left(x, y);
+      break;
+    default:;
+    }
+    break;
+  case 0x9:
+    op_skip_not_eq_reg(x, y);
+    break;
+  case 0xA:
+    op_set_index(nnn);
+    break;
+  case 0xB:
+    op_jump_with_offset(x, nn, nnn);
+    break;
+  case 0xC:
+    op_random(x, nn);
+    break;
+  case 0xD:
+    op_draw_sprite(x, y, n);
+    should_update_screen = true;
+    break;
+  case 0xE:
+    switch (nn) {
+    case 0x9E:
+      op_skip_if_key(x);
+      break;
+    case 0xA1:
+      op_skip_if_not_key(x);
+      break;
+    default:;
+    }
+    break;
+  case 0xF:
+    switch (nn) {
+    case 0x07:
+      op_set_reg_to_delay_timer(x);
+      break;
+    case 0x15:
+      op_set_delay_timer_to_reg(x);
+      break;
+    case 0x18:
+      op_set_sound_timer_to_reg(x);
+      break;
+    case 0x29:
+      op_set_font_char(x);
+      break;
+    case 0x33:
+      op_decode_to_decimal(x);
+      break;
+    case 0x55:
+      op_store_memory(x);
+      break;
+    case 0x65:
+      op_load_memory(x);
+      break;
+    case 0x0A:
+      op_get_key(x);
+      break;
+    case 0x1E:
+      op_add_to_index(x);
+      break;
+    default:;
+    }
+    // exit(1);
+    break;
+  default:
+    printf("undefined instruction: %x\n", op_type);
+    // exit(1);
+  }
+
+  instruction_cycles =
+      instruction_cost(instruction, program_counter == next_instruction + 2);
+  return should_update_screen;
+}
+
+void op_jump(uint16_t dst) { program_counter = dst; }
+
+void op_set_register(uint8_t reg, uint8_t value) { v[reg] = value; }
+
+void op_add_to_register(uint8_t reg, uint8_t value) { v[reg] += value; }
+
+void op_set_index(uint16_t value) { index_register = value; }
+
+void op_draw_sprite(uint8_t reg1, uint8_t reg2, uint8_t n) {
+  int target_pos_x = v[reg1] & (SCREEN_W - 1);
+  int target_pos_y = v[reg2] & (SCREEN_H - 1);
+  // int target_pos_x = v[reg1];
+  // int target_pos_y = v[reg2];
+  v[0xf] = 0;
+
+  uint8_t *sprite = memory + index_register;
+  for (int i = 0; i < n; ++i) {
+    int effective_pos_y = target_pos_y + i;
+    if (effective_pos_y >= SCREEN_H) {
+      ++sprite;
+      continue;
+    }
+
+    uint8_t sprite_bits[8];
+    byte_to_bits(*sprite, sprite_bits);
+
+    // the bits past the right edge fall off the end of the row
+    screen_rows[effective_pos_y] ^= ((uint64_t)*sprite << 56) >> target_pos_x;
+
+    for (int j = 0; j < 8; ++j) {
+      int effective_pos_x = target_pos_x + j;
+      if (effective_pos_x >= SCREEN_W) {
+        break;
+      }
+
+      bool current_pixel_state = screen_state[effective_pos_y][effective_pos_x];
+      screen_state[effective_pos_y][effective_pos_x] ^= sprite_bits[j];
+      if (sprite_bits[j]) {
+        screen_hash ^= pixel_hash(effective_pos_x, effective_pos_y);
+      }
+
+      if (current_pixel_state &&
+          !screen_state[effective_pos_y][effective_pos_x]) {
+        v[0xf] = 1;
+      }
+    }
+
+    ++sprite;
+  }
+}
+
+void op_clear_screen() {
+  for (int i = 0; i < SCREEN_H; ++i) {
+    for (int j = 0; j < SCREEN_W; ++j) {
+      screen_state[i][j] = 0x0;
+    }
+  }
+  memset(screen_rows, 0, sizeof(screen_rows));
+
+  screen_hash = 0;
+}
+
+void op_skip_eq_reg_num(uint8_t reg, uint8_t value) {
+  if (v[reg] == value) {
+    program_counter += 2;
+  }
+}
+void op_skip_not_eq_reg_num(uint8_t reg, uint8_t value) {
+  if (v[reg] != value) {
+    program_counter += 2;
+  }
+}
+
+void op_skip_eq_reg(uint8_t reg1, uint8_t reg2) {
+  if (v[reg1] == v[reg2]) {
+    program_counter += 2;
+  }
+}
+
+void op_skip_not_eq_reg(uint8_t reg1, uint8_t reg2) {
+  if (v[reg1] != v[reg2]) {
+    program_counter += 2;
+  }
+}
+
+// a return without a call or a call too deep stops the machine on the
+// faulting instruction, the host sees it through faulted
+void op_return_subroutine() {
+  int16_t next_action;
+  if (!stack_pop(&functions_stack, &next_action)) {
+    program_counter -= 2;
+    faulted = true;
+    return;
+  }
+
+  program_counter = next_action;
+}
+
+void op_call_subroutine(uint16_t function) {
+  if (!stack_push(&functions_stack, program_counter)) {
+    program_counter -= 2;
+    faulted = true;
+    return;
+  }
+
+  program_counter = function;
+}
+
+void op_set(uint8_t reg1, uint8_t reg2) { v[reg1] = v[reg2]; }
+
+void op_binary_or(uint8_t reg1, uint8_t reg2) {
+  v[reg1] = v[reg1] | v[reg2];
+  v[0xF] = 0;
+}
+
+void op_binary_and(uint8_t reg1, uint8_t reg2) {
+  v[reg1] = v[reg1] & v[reg2];
+  v[0xF] = 0;
+}
+
+void op_binary_xor(uint8_t reg1, uint8_t reg2) {
+  v[reg1] = v[reg1] ^ v[reg2];
+  v[0xF] = 0;
+}
+
+void op_add_registers(uint8_t reg1, uint8_t reg2) {
+  uint8_t a = v[reg1];
+  uint8_t b = v[reg2];
+  uint8_t c = a + b;
+
+  v[reg1] = c;
+  v[0xF] = c < a ? 1 : 0;
+}
+
+void op_vx_minus_vy(uint8_t reg1, uint8_t reg2) {
+  uint8_t vx = v[reg1];
+  uint8_t vy = v[reg2];
+  uint8_t flag = (vx >= vy) ? 1 : 0;
+
+  v[reg1] = vx - vy;
+  v[0xF] = flag;
+}
+
+void op_vy_minus_vx(uint8_t reg1, uint8_t reg2) {
+  uint8_t vx = v[reg1];
+  uint8_t vy = v[reg2];
+  uint8_t flag = (vy >= vx) ? 1 : 0;
+
+  v[reg1] = vy - vx;
+  v[0xF] = flag;
+}
+
+void op_shift_right(uint8_t reg1, uint8_t reg2) {
+  if (legacy_mode) {
+    uint8_t shifted_bit = v[reg2] & 0x01;
+    v[reg1] = v[reg2] >> 1;
+    v[0xf] = shifted_bit;
+    return;
+  }
+
+  uint8_t shifted_bit = v[reg1] & 0x01;
+  v[reg1] >>= 1;
+  v[0xf] = shifted_bit;
+}
+
+void op_shift_left(uint8_t reg1, uint8_t reg2) {
+  if (legacy_mode) {
+    uint8_t shifted_bit = (v[reg2] & 0x80) >> 7;
+    v[reg1] = v[reg2] << 1;
+    v[0xf] = shifted_bit;
+    return;
+  }
+
+  uint8_t shifted_bit = (v[reg1] & 0x80) >> 7;
+  v[reg1] <<= 1;
+  v[0xf] = shifted_bit;
+}
+
+void op_jump_with_offset(uint8_t reg1, uint8_t nn, uint16_t nnn) {
+  if (legacy_mode) {
+    program_counter = nnn;
+    program_counter += v[0];
+    return;
+  }
+
+  program_counter = nnn;
+  program_counter += v[reg1];
+}
+
+void op_random(uint8_t reg1, uint8_t nn) {
+  v[reg1] = (next_random() % 255) & nn;
+}
+
+static bool key_held(uint8_t key) {
+  return key < 16 && ((keyboard >> key) & 1);
+}
+
+void op_skip_if_key(uint8_t reg) {
+  if (key_held(v[reg])) {
+    program_counter += 2;
+  }
+}
+
+void op_skip_if_not_key(uint8_t reg) {
+  if (!key_held(v[reg])) {
+    program_counter += 2;
+  }
+}
+
+void op_set_reg_to_delay_timer(uint8_t reg) { v[reg] = delay_timer; }
+
+void op_set_delay_timer_to_reg(uint8_t reg) { delay_timer = v[reg]; }
+
+void op_set_sound_timer_to_reg(uint8_t reg) { audio_timer = v[reg]; }
+
+void op_add_to_index(uint8_t reg) { index_register += v[reg]; }
+
+// the pc stays on the FX0A until set_keys sees the key released
+void op_get_key(uint8_t reg) {
+  program_counter -= 2;
+  key_waiting = true;
+  key_wait_register = reg;
+  key_wait_pressed = 0;
+}
+
+void op_set_font_char(uint8_t reg) {
+  index_register = (v[reg] * 5) + FONT_MEMORY_LOCATION;
+}
+
+void op_decode_to_decimal(uint8_t reg) {
+  uint8_t val = v[reg];
+
+  write_memory(index_register + 2, val % 10);
+  val /= 10;
+
+  write_memory(index_register + 1, val % 10);
+  val /= 10;
+
+  write_memory(index_register, val);
+}
+
+void op_store_memory(uint8_t reg) {
+  for (int i = 0; i <= reg; ++i) {
+    write_memory(index_register + i, v[i]);
+  }
+
+  if (legacy_mode) {
+    index_register += reg + 1;
+  }
+}
+
+void op_load_memory(uint8_t reg) {
+  for (int i = 0; i <= reg; ++i) {
+    v[i] = memory[index_register + i];
+  }
+
+  if (legacy_mode) {
+    index_register += reg + 1;
+  }
+}
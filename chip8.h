@@ -0,0 +1,168 @@
+#ifndef CHIP8_H
+#define CHIP8_H
+
+#include "stack.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEMSIZE 4096
+#define SCREEN_W 64
+#define SCREEN_H 32
+#define FONT_MEMORY_LOCATION 0x050
+#define FONTSET_SIZE 80
+#define PROGRAM_START 0x200
+#define CPU_FREQUENCY 700  // default instructions per second
+#define TIMER_FREQUENCY 60 // timers and screen refresh per second
+
+// the vip runs 1.76 MHz / 8 clocks = 220k machine cycles per second, less
+// the 1024 cycles per frame taken by the display dma
+#define VIP_FRAME_CYCLES (3668 - 1024)
+
+typedef enum timing_profile {
+  TIMING_MODERN, // every instruction costs the same, cpu_frequency per second
+  TIMING_VIP,    // cosmac vip machine cycles per instruction
+} TimingProfile;
+
+// machine state, owned by chip8.c. there is a single machine per process.
+extern bool legacy_mode;
+extern int cpu_frequency; // instructions per second
+extern TimingProfile timing_profile;
+extern bool display_wait; // DXYN ends the frame's execution, like on the vip
+extern bool screen_state[SCREEN_H][SCREEN_W];
+extern uint64_t screen_rows[SCREEN_H]; // screen_state a row per word, bit 63
+                                       // is the leftmost pixel
+extern const uint8_t fonts[FONTSET_SIZE];
+
+extern uint8_t memory[MEMSIZE];
+extern int16_t program_counter;
+extern int16_t index_register; // index register
+extern uint8_t v[16];          // general purpose variables registers
+extern Stack functions_stack;  // functions / subroutines stack
+extern uint8_t delay_timer;    // decremented at rate of 60hz until 0
+extern uint8_t audio_timer;    // like delay_timer, beeps at numbers != 0
+extern uint16_t keyboard;     // held keys, bit i is key i
+
+// FX0A stops the machine until a key is pressed and released again
+extern bool key_waiting;
+extern uint8_t key_wait_register;
+extern uint16_t key_wait_pressed; // keys pressed since the wait started
+
+extern uint64_t memory_hash; // kept up to date on every memory write
+extern uint64_t screen_hash; // kept up to date on every pixel change
+extern bool self_jump;       // a 1NNN jumped to itself, the rom is halted
+extern bool faulted;         // the stack over or underflowed, nothing runs
+extern uint64_t random_state; // CXNN generator, part of the machine state
+extern int cycle_remainder;   // budget left for run_frame, negative in debt
+extern int instruction_cycles; // cost of the last executed instruction
+
+// everything needed to put the machine back to an earlier point in time
+typedef struct machine_state {
+  uint8_t memory[MEMSIZE];
+  bool screen_state[SCREEN_H][SCREEN_W];
+  uint64_t screen_rows[SCREEN_H];
+  int16_t program_counter;
+  int16_t index_register;
+  uint8_t v[16];
+  Stack functions_stack;
+  uint8_t delay_timer;
+  uint8_t audio_timer;
+  uint16_t keyboard;
+  bool key_waiting;
+  uint8_t key_wait_register;
+  uint16_t key_wait_pressed;
+  uint64_t memory_hash;
+  uint64_t screen_hash;
+  bool self_jump;
+  bool faulted;
+  uint64_t random_state;
+  int cycle_remainder;
+} MachineState;
+
+// called before every write done by the running program, NULL when unused
+extern void (*memory_write_hook)(uint16_t address, uint8_t value);
+
+// called by run_frame before every instruction, returning true ends the frame
+// early and the next run_frame picks it up where it stopped. NULL when unused.
+extern bool (*cycle_hook)();
+
+// an opcode split into its fields, shared by everything that decodes
+typedef struct instruction {
+  uint16_t op_code;
+  uint8_t type; // highest nibble
+  uint8_t x;
+  uint8_t y;
+  uint8_t n;
+  uint8_t nn;
+  uint16_t nnn;
+} Instruction;
+
+static inline Instruction decode_instruction(uint16_t op_code) {
+  Instruction instruction;
+  instruction.op_code = op_code;
+  instruction.type = (op_code & 0xF000) >> 12;
+  instruction.x = (op_code & 0x0F00) >> 8;
+  instruction.y = (op_code & 0x00F0) >> 4;
+  instruction.n = op_code & 0x000F;
+  instruction.nn = op_code & 0x00FF;
+  instruction.nnn = op_code & 0x0FFF;
+
+  return instruction;
+}
+
+// utils
+uint8_t *byte_to_bits(const uint8_t byte, uint8_t *bits_arr);
+uint64_t mix_hash(uint64_t x);
+void rehash_machine();
+uint64_t machine_state_hash();
+
+// emulator generic functions
+void reset_machine();
+bool init_emulator(
+    char *rom_name); // loads stuff into memory and bootstraps the system
+bool load_program(char *program_file_path);
+bool execute_cycle();
+void tick_timers();
+int instruction_cost(Instruction instruction, bool skipped);
+bool run_frame();
+void set_keys(uint16_t keys);
+void seed_random(uint64_t seed);
+void save_machine(MachineState *state);
+void load_machine(const MachineState *state);
+
+// emulator opetaion functions
+void op_clear_screen();
+void op_jump(uint16_t dst);
+void op_return_subroutine();
+void op_set_index(uint16_t value);
+void op_set(uint8_t reg1, uint8_t reg2);
+void op_call_subroutine(uint16_t function);
+void op_binary_or(uint8_t reg1, uint8_t reg2);
+void op_binary_and(uint8_t reg1, uint8_t reg2);
+void op_binary_xor(uint8_t reg1, uint8_t reg2);
+void op_skip_eq_reg(uint8_t reg1, uint8_t reg2);
+void op_set_register(uint8_t reg, uint8_t value);
+void op_add_registers(uint8_t reg1, uint8_t reg2);
+void op_skip_eq_reg_num(uint8_t reg, uint8_t value);
+void op_skip_not_eq_reg(uint8_t reg1, uint8_t reg2);
+void op_add_to_register(uint8_t reg, uint8_t value);
+void op_vy_minus_vx(uint8_t reg1, uint8_t reg2);
+void op_vx_minus_vy(uint8_t reg1, uint8_t reg2);
+void op_skip_not_eq_reg_num(uint8_t reg, uint8_t value);
+void op_draw_sprite(uint8_t reg1, uint8_t reg2, uint8_t n);
+void op_shift_right(uint8_t reg1, uint8_t reg2);
+void op_shift_left(uint8_t reg1, uint8_t reg2);
+void op_jump_with_offset(uint8_t reg1, uint8_t nn, uint16_t nnn);
+void op_random(uint8_t reg1, uint8_t nn);
+void op_skip_if_key(uint8_t reg1);
+void op_skip_if_not_key(uint8_t reg1);
+void op_set_reg_to_delay_timer(uint8_t reg);
+void op_set_delay_timer_to_reg(uint8_t reg);
+void op_set_sound_timer_to_reg(uint8_t reg);
+void op_add_to_index(uint8_t reg);
+void op_get_key(uint8_t reg);
+void op_set_font_char(uint8_t reg);
+void op_decode_to_decimal(uint8_t reg);
+void op_store_memory(uint8_t reg);
+void op_load_memory(uint8_t reg);
+
+#endif // !CHIP8_H
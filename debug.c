@@ -0,0 +1,345 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "debug.h"
+#include "disasm.h"
+
+bool debug_armed = false;
+static Debugger debugger;
+
+static bool bit_is_set(const uint8_t *bitmap, uint16_t address) {
+  return (bitmap[address >> 3] >> (address & 7)) & 1;
+}
+
+static void set_bit(uint8_t *bitmap, uint16_t address, bool value) {
+  if (value) {
+    bitmap[address >> 3] |= 1 << (address & 7);
+  } else {
+    bitmap[address >> 3] &= ~(1 << (address & 7));
+  }
+}
+
+static void update_armed() {
+  debug_armed = debugger.breakpoints_count > 0 || debugger.watch_hit ||
+                debugger.stepping;
+  cycle_hook = debug_armed ? debug_should_stop : NULL;
+}
+
+static void reply(const char *format, ...) {
+  if (debugger.client_fd == -1) {
+    return;
+  }
+
+  char message[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(message, sizeof(message), format, args);
+  va_end(args);
+
+  if (length > (int)sizeof(message) - 1) {
+    length = sizeof(message) - 1;
+  }
+
+  if (write(debugger.client_fd, message, length) == -1) {
+    close(debugger.client_fd);
+    debugger.client_fd = -1;
+  }
+}
+
+static void on_memory_write(uint16_t address, uint8_t value) {
+  if (address < MEMSIZE && bit_is_set(debugger.watchpoints, address)) {
+    debugger.watch_hit = true;
+    debugger.watch_address = address;
+    debugger.watch_value = value;
+    debug_armed = true;
+    cycle_hook = debug_should_stop;
+  }
+}
+
+static void resume(bool stepping, uint32_t steps) {
+  debugger.paused = false;
+  debugger.stepping = stepping;
+  debugger.steps_left = steps;
+  debugger.skip_breakpoint = true;
+  debugger.resume_pc = program_counter;
+  update_armed();
+}
+
+static void stop(const char *reason) {
+  debugger.paused = true;
+  debugger.stepping = false;
+  update_armed();
+
+  // the pc can be anywhere after a wild jump, wrap like the address bus
+  char text[32];
+  uint16_t op_code = (memory[program_counter & 0xFFF] << 8) |
+                     memory[(program_counter + 1) & 0xFFF];
+  reply("stopped %s pc=0x%03X %s\n", reason, program_counter,
+        disassemble(op_code, text, sizeof(text)));
+}
+
+static bool parse_address(const char *text, uint16_t *address) {
+  if (text == NULL) {
+    return false;
+  }
+
+  char *end;
+  long value = strtol(text, &end, 16);
+  if (*end != '\0' || value < 0 || value >= MEMSIZE) {
+    return false;
+  }
+
+  *address = value;
+  return true;
+}
+
+static void show_registers() {
+  reply("pc=0x%03X i=0x%03X dt=%d st=%d", program_counter, index_register,
+        delay_timer, audio_timer);
+  for (int i = 0; i < 16; ++i) {
+    reply(" v%X=0x%02X", i, v[i]);
+  }
+  reply("\n");
+}
+
+static void show_stack() {
+  reply("depth=%d", functions_stack.head + 1);
+  for (int i = functions_stack.head; i >= 0; --i) {
+    reply(" 0x%03X", functions_stack.data[i]);
+  }
+  reply("\n");
+}
+
+static void show_memory(uint16_t address, int length) {
+  for (int i = 0; i < length && address + i < MEMSIZE; ++i) {
+    if (i % 16 == 0) {
+      reply(i == 0 ? "0x%03X:" : "\n0x%03X:", address + i);
+    }
+    reply(" %02X", memory[address + i]);
+  }
+  reply("\n");
+}
+
+static void show_disassembly(uint16_t address, int count) {
+  char text[32];
+  for (int i = 0; i < count && address + 1 < MEMSIZE; ++i, address += 2) {
+    uint16_t op_code = (memory[address] << 8) | memory[address + 1];
+    reply("%c%c0x%03X  %04X  %s\n", address == program_counter ? '>' : ' ',
+          bit_is_set(debugger.breakpoints, address) ? '*' : ' ', address,
+          op_code, disassemble(op_code, text, sizeof(text)));
+  }
+}
+
+// commands are one per line, every answer ends with "ok" or "error: ..."
+static void run_command(char *line) {
+  char *command = strtok(line, " \t\r");
+  char *arg1 = strtok(NULL, " \t\r");
+  char *arg2 = strtok(NULL, " \t\r");
+  uint16_t address;
+
+  if (command == NULL) {
+    return;
+  }
+
+  if (strcmp(command, "break") == 0 || strcmp(command, "delete") == 0) {
+    if (!parse_address(arg1, &address)) {
+      reply("error: bad address\n");
+      return;
+    }
+
+    bool enable = command[0] == 'b';
+    if (bit_is_set(debugger.breakpoints, address) != enable) {
+      set_bit(debugger.breakpoints, address, enable);
+      debugger.breakpoints_count += enable ? 1 : -1;
+    }
+    update_armed();
+  } else if (strcmp(command, "watch") == 0 ||
+             strcmp(command, "unwatch") == 0) {
+    if (!parse_address(arg1, &address)) {
+      reply("error: bad address\n");
+      return;
+    }
+
+    bool enable = command[0] == 'w';
+    if (bit_is_set(debugger.watchpoints, address) != enable) {
+      set_bit(debugger.watchpoints, address, enable);
+      debugger.watchpoints_count += enable ? 1 : -1;
+    }
+    memory_write_hook = debugger.watchpoints_count > 0 ? on_memory_write : NULL;
+  } else if (strcmp(command, "continue") == 0 || strcmp(command, "c") == 0) {
+    resume(false, 0);
+  } else if (strcmp(command, "step") == 0 || strcmp(command, "s") == 0) {
+    resume(true, arg1 ? strtoul(arg1, NULL, 10) : 1);
+  } else if (strcmp(command, "pause") == 0) {
+    debugger.paused = true;
+    debugger.stepping = false;
+    update_armed();
+  } else if (strcmp(command, "regs") == 0) {
+    show_registers();
+  } else if (strcmp(command, "stack") == 0) {
+    show_stack();
+  } else if (strcmp(command, "mem") == 0) {
+    if (!parse_address(arg1, &address)) {
+      reply("error: bad address\n");
+      return;
+    }
+    show_memory(address, arg2 ? atoi(arg2) : 16);
+  } else if (strcmp(command, "disasm") == 0) {
+    address = program_counter;
+    if (arg1 && !parse_address(arg1, &address)) {
+      reply("error: bad address\n");
+      return;
+    }
+    show_disassembly(address, arg2 ? atoi(arg2) : DEBUG_DISASM_LINES);
+  } else {
+    reply("error: unknown command %s\n", command);
+    return;
+  }
+
+  reply("ok\n");
+}
+
+bool debug_start(const char *socket_path) {
+  memset(&debugger, 0, sizeof(Debugger));
+  debugger.client_fd = -1;
+  debugger.paused = true; // give the client a chance to set breakpoints
+  snprintf(debugger.socket_path, sizeof(debugger.socket_path), "%s",
+           socket_path);
+
+  // a client going away must not kill the emulator
+  signal(SIGPIPE, SIG_IGN);
+
+  debugger.server_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (debugger.server_fd == -1) {
+    printf("could not create the debugger socket\n");
+    return false;
+  }
+
+  struct sockaddr_un address;
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  snprintf(address.sun_path, sizeof(address.sun_path), "%s", socket_path);
+  unlink(socket_path);
+
+  if (bind(debugger.server_fd, (struct sockaddr *)&address,
+           sizeof(address)) == -1 ||
+      listen(debugger.server_fd, 1) == -1) {
+    printf("could not listen on %s\n", socket_path);
+    close(debugger.server_fd);
+    return false;
+  }
+
+  fcntl(debugger.server_fd, F_SETFL, O_NONBLOCK);
+  printf("debugger listening on %s, paused\n", socket_path);
+  return true;
+}
+
+// accept a client and run the commands it sent, never blocks
+void debug_poll() {
+  if (debugger.client_fd == -1) {
+    int client = accept(debugger.server_fd, NULL, NULL);
+    if (client == -1) {
+      return;
+    }
+
+    fcntl(client, F_SETFL, O_NONBLOCK);
+    debugger.client_fd = client;
+    debugger.input_length = 0;
+    reply("chip8 debugger, %s\n", debugger.paused ? "paused" : "running");
+  }
+
+  while (debugger.client_fd != -1) {
+    int space = DEBUG_INPUT_SIZE - 1 - debugger.input_length;
+    ssize_t received =
+        read(debugger.client_fd, debugger.input + debugger.input_length, space);
+    if (received == 0 || (received == -1 && errno != EAGAIN &&
+                          errno != EWOULDBLOCK && errno != EINTR)) {
+      close(debugger.client_fd);
+      debugger.client_fd = -1;
+      return;
+    }
+
+    if (received <= 0) {
+      return;
+    }
+
+    debugger.input_length += received;
+    debugger.input[debugger.input_length] = '\0';
+
+    char *line = debugger.input;
+    char *newline;
+    while ((newline = strchr(line, '\n')) != NULL) {
+      *newline = '\0';
+      run_command(line);
+      line = newline + 1;
+    }
+
+    debugger.input_length -= line - debugger.input;
+    memmove(debugger.input, line, debugger.input_length);
+
+    // a line longer than the buffer can never complete, drop it
+    if (debugger.input_length == DEBUG_INPUT_SIZE - 1) {
+      debugger.input_length = 0;
+      reply("error: line too long\n");
+    }
+  }
+}
+
+// called before every instruction while debug_armed is set
+bool debug_should_stop() {
+  if (debugger.watch_hit) {
+    debugger.watch_hit = false;
+
+    char reason[48];
+    snprintf(reason, sizeof(reason), "watchpoint 0x%03X=0x%02X",
+             debugger.watch_address, debugger.watch_value);
+    stop(reason);
+    return true;
+  }
+
+  if (debugger.skip_breakpoint && program_counter == debugger.resume_pc) {
+    debugger.skip_breakpoint = false;
+  } else if (program_counter >= 0 && program_counter < MEMSIZE &&
+             bit_is_set(debugger.breakpoints, program_counter)) {
+    stop("breakpoint");
+    return true;
+  } else {
+    debugger.skip_breakpoint = false;
+  }
+
+  if (debugger.stepping) {
+    if (debugger.steps_left == 0) {
+      stop("step");
+      return true;
+    }
+
+    --debugger.steps_left;
+  }
+
+  return false;
+}
+
+bool debug_is_paused() { return debugger.paused; }
+
+void debug_stop() {
+  memory_write_hook = NULL;
+  cycle_hook = NULL;
+  debug_armed = false;
+
+  if (debugger.client_fd != -1) {
+    close(debugger.client_fd);
+  }
+
+  close(debugger.server_fd);
+  unlink(debugger.socket_path);
+}
@@ -0,0 +1,44 @@
+#ifndef DEBUG_H
+#define DEBUG_H
+
+#include "chip8.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define DEBUG_INPUT_SIZE 1024
+#define DEBUG_DISASM_LINES 10
+
+typedef struct debugger {
+  int server_fd;
+  int client_fd;
+  char socket_path[108];
+  char input[DEBUG_INPUT_SIZE];
+  int input_length;
+
+  uint8_t breakpoints[MEMSIZE / 8]; // one bit per address
+  uint8_t watchpoints[MEMSIZE / 8];
+  int breakpoints_count;
+  int watchpoints_count;
+
+  bool paused;
+  bool stepping;
+  uint32_t steps_left;
+  bool skip_breakpoint; // resuming from a breakpoint must not stop on it again
+  int16_t resume_pc;
+
+  bool watch_hit;
+  uint16_t watch_address;
+  uint8_t watch_value;
+} Debugger;
+
+// debug_should_stop is installed as cycle_hook only while this is set, so a
+// session without breakpoints, watch hits or stepping costs a single branch
+extern bool debug_armed;
+
+bool debug_start(const char *socket_path);
+void debug_poll();
+bool debug_should_stop();
+bool debug_is_paused();
+void debug_stop();
+
+#endif // !DEBUG_H
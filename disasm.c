@@ -0,0 +1,114 @@
+#include <stdint.h>
+#include <stdio.h>
+
+#include "chip8.h"
+#include "disasm.h"
+
+static const char *alu_mnemonics[16] = {
+    "LD", "OR", "AND", "XOR", "ADD", "SUB", "SHR", "SUBN",
+    NULL, NULL, NULL,  NULL,  NULL,  NULL,  "SHL", NULL,
+};
+
+char *disassemble(uint16_t op_code, char *out, size_t size) {
+  Instruction in = decode_instruction(op_code);
+
+  switch (in.type) {
+  case 0x0:
+    if (in.nn == 0xE0) {
+      snprintf(out, size, "CLS");
+    } else if (in.nn == 0xEE) {
+      snprintf(out, size, "RET");
+    } else {
+      snprintf(out, size, "SYS 0x%03X", in.nnn);
+    }
+    return out;
+  case 0x1:
+    snprintf(out, size, "JP 0x%03X", in.nnn);
+    return out;
+  case 0x2:
+    snprintf(out, size, "CALL 0x%03X", in.nnn);
+    return out;
+  case 0x3:
+    snprintf(out, size, "SE V%X, 0x%02X", in.x, in.nn);
+    return out;
+  case 0x4:
+    snprintf(out, size, "SNE V%X, 0x%02X", in.x, in.nn);
+    return out;
+  case 0x5:
+    snprintf(out, size, "SE V%X, V%X", in.x, in.y);
+    return out;
+  case 0x6:
+    snprintf(out, size, "LD V%X, 0x%02X", in.x, in.nn);
+    return out;
+  case 0x7:
+    snprintf(out, size, "ADD V%X, 0x%02X", in.x, in.nn);
+    return out;
+  case 0x8:
+    if (alu_mnemonics[in.n] == NULL) {
+      break;
+    }
+    snprintf(out, size, "%s V%X, V%X", alu_mnemonics[in.n], in.x, in.y);
+    return out;
+  case 0x9:
+    snprintf(out, size, "SNE V%X, V%X", in.x, in.y);
+    return out;
+  case 0xA:
+    snprintf(out, size, "LD I, 0x%03X", in.nnn);
+    return out;
+  case 0xB:
+    snprintf(out, size, "JP V0, 0x%03X", in.nnn);
+    return out;
+  case 0xC:
+    snprintf(out, size, "RND V%X, 0x%02X", in.x, in.nn);
+    return out;
+  case 0xD:
+    snprintf(out, size, "DRW V%X, V%X, %d", in.x, in.y, in.n);
+    return out;
+  case 0xE:
+    if (in.nn == 0x9E) {
+      snprintf(out, size, "SKP V%X", in.x);
+      return out;
+    }
+    if (in.nn == 0xA1) {
+      snprintf(out, size, "SKNP V%X", in.x);
+      return out;
+    }
+    break;
+  case 0xF:
+    switch (in.nn) {
+    case 0x07:
+      snprintf(out, size, "LD V%X, DT", in.x);
+      return out;
+    case 0x0A:
+      snprintf(out, size, "LD V%X, K", in.x);
+      return out;
+    case 0x15:
+      snprintf(out, size, "LD DT, V%X", in.x);
+      return out;
+    case 0x18:
+      snprintf(out, size, "LD ST, V%X", in.x);
+      return out;
+    case 0x1E:
+      snprintf(out, size, "ADD I, V%X", in.x);
+      return out;
+    case 0x29:
+      snprintf(out, size, "LD F, V%X", in.x);
+      return out;
+    case 0x33:
+      snprintf(out, size, "LD B, V%X", in.x);
+      return out;
+    case 0x55:
+      snprintf(out, size, "LD [I], V%X", in.x);
+      return out;
+    case 0x65:
+      snprintf(out, size, "LD V%X, [I]", in.x);
+      return out;
+    default:;
+    }
+    break;
+  default:;
+  }
+
+  snprintf(out, size, "DW 0x%04X", op_code);
+  return out;
+}
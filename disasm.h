@@ -0,0 +1,11 @@
+#ifndef DISASM_H
+#define DISASM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// write the mnemonic for op_code into out, decoded the way execute_cycle
+// decodes it. unknown opcodes are shown as raw data words.
+char *disassemble(uint16_t op_code, char *out, size_t size);
+
+#endif // !DISASM_H
@@ -0,0 +1,113 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "env.h"
+
+static void env_run_frame(Env *env) {
+  if (run_frame()) {
+    env->screen_changed = true;
+  }
+
+  ++env->frame;
+
+  // a fault ends the episode whether or not halts are looked for
+  if (faulted) {
+    env->halt_reason = HALT_FAULT;
+  } else if (env->detect_halt) {
+    env->halt_reason = halt_check(&env->halt, env->frame);
+  }
+}
+
+static RewardHook *env_find_hook(Env *env, const char *name) {
+  for (int i = 0; i < env->reward_hooks_count; ++i) {
+    if (strcmp(env->reward_hooks[i].name, name) == 0) {
+      return &env->reward_hooks[i];
+    }
+  }
+
+  return NULL;
+}
+
+void env_init(Env *env, int frame_skip) {
+  memset(env, 0, sizeof(Env));
+  env->frame_skip = frame_skip > 0 ? frame_skip : 1;
+
+  env->observation.screen = screen_rows;
+  env->observation.memory = memory;
+  env->observation.v = v;
+  env->observation.program_counter = &program_counter;
+  env->observation.index_register = &index_register;
+  env->observation.delay_timer = &delay_timer;
+  env->observation.audio_timer = &audio_timer;
+  env->observation.frame = &env->frame;
+}
+
+bool env_reset(Env *env, char *rom_path, unsigned int seed) {
+  if (!init_emulator(rom_path)) {
+    return false;
+  }
+
+  seed_random(seed);
+  env->frame = 0;
+  env->screen_changed = false;
+  env->halt_reason = HALT_NONE;
+  halt_init(&env->halt);
+
+  for (int i = 0; i < env->reward_hooks_count; ++i) {
+    env->reward_hooks[i].last_value = memory[env->reward_hooks[i].address];
+  }
+
+  return true;
+}
+
+// hold the keys in the mask (bit i is key i) for frame_skip frames and return
+// the reward collected by the hooks over that period
+float env_step(Env *env, uint16_t keys) {
+  set_keys(keys);
+
+  env->screen_changed = false;
+  for (int i = 0; i < env->frame_skip && env->halt_reason == HALT_NONE; ++i) {
+    env_run_frame(env);
+  }
+
+  float reward = 0.0f;
+  for (int i = 0; i < env->reward_hooks_count; ++i) {
+    RewardHook *hook = &env->reward_hooks[i];
+    uint8_t value = memory[hook->address];
+
+    reward += hook->weight * ((int)value - (int)hook->last_value);
+    hook->last_value = value;
+  }
+
+  return reward;
+}
+
+const Observation *env_observe(Env *env) { return &env->observation; }
+
+bool env_add_reward_hook(Env *env, const char *name, uint16_t address,
+                         float weight) {
+  if (env->reward_hooks_count >= MAX_REWARD_HOOKS || address >= MEMSIZE ||
+      strlen(name) >= REWARD_HOOK_NAME_SIZE || env_find_hook(env, name)) {
+    return false;
+  }
+
+  RewardHook *hook = &env->reward_hooks[env->reward_hooks_count++];
+  strcpy(hook->name, name);
+  hook->address = address;
+  hook->weight = weight;
+  hook->last_value = memory[address];
+
+  return true;
+}
+
+// read the current byte behind a named hook, returns false for unknown names
+bool env_read_named(Env *env, const char *name, uint8_t *value) {
+  RewardHook *hook = env_find_hook(env, name);
+  if (hook == NULL) {
+    return false;
+  }
+
+  *value = memory[hook->address];
+  return true;
+}
@@ -0,0 +1,53 @@
+#ifndef ENV_H
+#define ENV_H
+
+#include "chip8.h"
+#include "halt.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MAX_REWARD_HOOKS 16
+#define REWARD_HOOK_NAME_SIZE 32
+
+// a named memory address whose change between steps is turned into reward
+typedef struct reward_hook {
+  char name[REWARD_HOOK_NAME_SIZE];
+  uint16_t address;
+  float weight;       // reward += weight * (current value - previous value)
+  uint8_t last_value; // value at the end of the previous step
+} RewardHook;
+
+// read only views into the live machine state. the pointers are set up once
+// by env_init and stay valid for the lifetime of the env, nothing is copied.
+typedef struct observation {
+  const uint64_t *screen; // SCREEN_H rows, bit 63 is the leftmost pixel
+  const uint8_t *memory;
+  const uint8_t *v;
+  const int16_t *program_counter;
+  const int16_t *index_register;
+  const uint8_t *delay_timer;
+  const uint8_t *audio_timer;
+  const uint64_t *frame; // frames executed since the last reset
+} Observation;
+
+typedef struct env {
+  int frame_skip; // frames executed by every env_step
+  uint64_t frame;
+  bool screen_changed; // the last env_step drew to the screen
+  bool detect_halt;    // stop stepping once the rom is stuck for good
+  HaltReason halt_reason; // HALT_FAULT is reported even without detect_halt
+  HaltDetector halt;
+  int reward_hooks_count;
+  RewardHook reward_hooks[MAX_REWARD_HOOKS];
+  Observation observation;
+} Env;
+
+void env_init(Env *env, int frame_skip);
+bool env_reset(Env *env, char *rom_path, unsigned int seed);
+float env_step(Env *env, uint16_t keys);
+const Observation *env_observe(Env *env);
+bool env_add_reward_hook(Env *env, const char *name, uint16_t address,
+                         float weight);
+bool env_read_named(Env *env, const char *name, uint8_t *value);
+
+#endif // !ENV_H
@@ -0,0 +1,175 @@
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "export.h"
+
+#define EXPORT_READ_RETRIES 16
+
+static bool export_map(FrameExport *exp, const char *name, bool create) {
+  memset(exp, 0, sizeof(FrameExport));
+  exp->fd = -1;
+
+  // posix wants shared memory names to start with a slash
+  snprintf(exp->name, sizeof(exp->name), "%s%s", name[0] == '/' ? "" : "/",
+           name);
+
+  int flags = create ? O_CREAT | O_RDWR : O_RDONLY;
+  exp->fd = shm_open(exp->name, flags, 0644);
+  if (exp->fd == -1) {
+    printf("could not open shared memory %s\n", exp->name);
+    return false;
+  }
+
+  // from here on a failure closes through export_close, which unlinks the
+  // object this call created
+  exp->owner = create;
+
+  if (create && ftruncate(exp->fd, sizeof(ExportRing)) == -1) {
+    printf("could not size shared memory %s\n", exp->name);
+    export_close(exp);
+    return false;
+  }
+
+  int prot = create ? PROT_READ | PROT_WRITE : PROT_READ;
+  void *ring = mmap(NULL, sizeof(ExportRing), prot, MAP_SHARED, exp->fd, 0);
+  if (ring == MAP_FAILED) {
+    printf("could not map shared memory %s\n", exp->name);
+    export_close(exp);
+    return false;
+  }
+
+  exp->ring = ring;
+  return true;
+}
+
+bool export_create(FrameExport *exp, const char *name) {
+  if (!export_map(exp, name, true)) {
+    return false;
+  }
+
+  memset(exp->ring, 0, sizeof(ExportRing));
+  exp->ring->slots_count = EXPORT_RING_SLOTS;
+  atomic_thread_fence(memory_order_release);
+  exp->ring->magic = EXPORT_MAGIC;
+
+  return true;
+}
+
+bool export_open(FrameExport *exp, const char *name) {
+  if (!export_map(exp, name, false)) {
+    return false;
+  }
+
+  if (exp->ring->magic != EXPORT_MAGIC ||
+      exp->ring->slots_count != EXPORT_RING_SLOTS) {
+    printf("shared memory %s is not a frame export\n", exp->name);
+    export_close(exp);
+    return false;
+  }
+
+  return true;
+}
+
+// copy the current machine state into the next slot. callers should only
+// publish frames where the screen changed.
+void export_publish(FrameExport *exp, uint64_t frame) {
+  ExportRing *ring = exp->ring;
+  uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  ExportSlot *slot = &ring->slots[head % EXPORT_RING_SLOTS];
+
+  uint32_t sequence =
+      atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+  atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  slot->frame.frame = frame;
+  slot->frame.program_counter = program_counter;
+  slot->frame.index_register = index_register;
+  slot->frame.delay_timer = delay_timer;
+  slot->frame.audio_timer = audio_timer;
+  memcpy(slot->frame.v, v, sizeof(v));
+  memcpy(slot->frame.screen, screen_rows, sizeof(screen_rows));
+
+  atomic_store_explicit(&slot->sequence, sequence + 2, memory_order_release);
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+// copy published frame number index, fails when it is not published yet or
+// was already overwritten by the writer
+bool export_read(FrameExport *exp, uint64_t index, ExportFrame *out) {
+  ExportRing *ring = exp->ring;
+  ExportSlot *slot = &ring->slots[index % EXPORT_RING_SLOTS];
+
+  for (int i = 0; i < EXPORT_READ_RETRIES; ++i) {
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (index >= head || head - index > EXPORT_RING_SLOTS) {
+      return false;
+    }
+
+    uint32_t before =
+        atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if (before & 1) {
+      continue;
+    }
+
+    memcpy(out, &slot->frame, sizeof(ExportFrame));
+    atomic_thread_fence(memory_order_acquire);
+
+    uint32_t after =
+        atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (before == after && head - index <= EXPORT_RING_SLOTS) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool export_read_latest(FrameExport *exp, ExportFrame *out) {
+  for (int i = 0; i < EXPORT_READ_RETRIES; ++i) {
+    uint64_t head =
+        atomic_load_explicit(&exp->ring->head, memory_order_acquire);
+    if (head == 0) {
+      return false;
+    }
+
+    if (export_read(exp, head - 1, out)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// one bool per pixel, for readers that do not want to deal with the bits
+void export_unpack_screen(const ExportFrame *frame,
+                          bool screen[SCREEN_H][SCREEN_W]) {
+  for (int y = 0; y < SCREEN_H; ++y) {
+    for (int x = 0; x < SCREEN_W; ++x) {
+      screen[y][x] = (frame->screen[y] >> (63 - x)) & 1;
+    }
+  }
+}
+
+void export_close(FrameExport *exp) {
+  if (exp->ring) {
+    munmap(exp->ring, sizeof(ExportRing));
+    exp->ring = NULL;
+  }
+
+  if (exp->fd != -1) {
+    close(exp->fd);
+    exp->fd = -1;
+  }
+
+  if (exp->owner) {
+    shm_unlink(exp->name);
+    exp->owner = false;
+  }
+}
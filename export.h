@@ -0,0 +1,58 @@
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include "chip8.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define EXPORT_MAGIC 0x32504843 // "CHP2", changes with the layout
+#define EXPORT_RING_SLOTS 8
+
+// a completed frame together with the registers at the time it was shown
+typedef struct export_frame {
+  uint64_t frame;
+  int16_t program_counter;
+  int16_t index_register;
+  uint8_t delay_timer;
+  uint8_t audio_timer;
+  uint8_t v[16];
+  uint64_t screen[SCREEN_H]; // screen_rows, see export_unpack_screen
+} ExportFrame;
+
+// seqlock protected slot: odd sequence means the writer is inside the slot
+typedef struct export_slot {
+  _Atomic uint32_t sequence;
+  ExportFrame frame;
+} ExportSlot;
+
+// layout of the shared memory object. head counts published frames, the
+// latest one lives in slots[(head - 1) % EXPORT_RING_SLOTS].
+typedef struct export_ring {
+  uint32_t magic;
+  uint32_t slots_count;
+  _Atomic uint64_t head;
+  ExportSlot slots[EXPORT_RING_SLOTS];
+} ExportRing;
+
+typedef struct frame_export {
+  char name[64];
+  int fd;
+  bool owner; // the writer unlinks the object on close
+  ExportRing *ring;
+} FrameExport;
+
+// writer side, used by the emulator
+bool export_create(FrameExport *exp, const char *name);
+void export_publish(FrameExport *exp, uint64_t frame);
+
+// reader side, never blocks the writer
+bool export_open(FrameExport *exp, const char *name);
+bool export_read(FrameExport *exp, uint64_t index, ExportFrame *out);
+bool export_read_latest(FrameExport *exp, ExportFrame *out);
+void export_unpack_screen(const ExportFrame *frame,
+                          bool screen[SCREEN_H][SCREEN_W]);
+
+void export_close(FrameExport *exp);
+
+#endif // !EXPORT_H
@@ -0,0 +1,555 @@
+#include <dirent.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+
+#define FUZZ_ROM_SIZE (MEMSIZE - PROGRAM_START)
+#define FUZZ_MAX_SEEDS 64
+#define FUZZ_MAX_FINDINGS 32
+#define FUZZ_TIMER_EVERY 12 // instructions between timer ticks, as at 700 ips
+#define FUZZ_KEYS_EVERY 96  // instructions between changes of the keys
+
+typedef struct fuzz_case {
+  uint8_t rom[FUZZ_ROM_SIZE];
+  size_t size;
+  uint64_t seed; // drives the machine randoms and the keys
+  bool legacy_mode;
+} FuzzCase;
+
+typedef enum outcome_kind {
+  OUTCOME_OK,
+  OUTCOME_FAULT,      // the next instruction would crash or leave memory
+  OUTCOME_DIVERGENCE, // an engine ended in another state than the reference
+} OutcomeKind;
+
+typedef struct outcome {
+  OutcomeKind kind;
+  const char *what;   // fault or first state field that differs
+  const char *engine; // engine that failed
+  uint64_t step;      // instruction where it was seen, or run when ok
+} Outcome;
+
+// an execution path that must behave exactly like execute_cycle
+typedef struct engine {
+  const char *name;
+  bool (*execute)();
+} Engine;
+
+static bool reference_execute() { return execute_cycle(); }
+
+// what netplay does on a rollback: run, restore the snapshot and run again.
+// catches state that save_machine / load_machine forget.
+static MachineState rollback_snapshot;
+static bool rollback_execute() {
+  save_machine(&rollback_snapshot);
+  execute_cycle();
+  load_machine(&rollback_snapshot);
+
+  return execute_cycle();
+}
+
+// the first engine is the reference, new fast paths are added here
+static const Engine engines[] = {
+    {"reference", reference_execute},
+    {"rollback", rollback_execute},
+};
+#define ENGINES_COUNT (int)(sizeof(engines) / sizeof(engines[0]))
+
+static uint64_t next_random(uint64_t *state) {
+  *state += 0x9E3779B97F4A7C15ULL;
+  return mix_hash(*state);
+}
+
+static bool out_of_memory(int address, int length) {
+  return address < 0 || address + length > MEMSIZE;
+}
+
+// the crashes the interpreter does not guard against, checked before the
+// instruction runs: reads or writes past memory. stack faults are part of the
+// machine state and compared like the rest.
+static const char *predict_fault() {
+  if (out_of_memory(program_counter, 2)) {
+    return "pc outside memory";
+  }
+
+  uint16_t op_code = (memory[program_counter] << 8) |
+                     memory[program_counter + 1];
+  Instruction in = decode_instruction(op_code);
+
+  if (in.type == 0xD) {
+    // rows below the screen are skipped without reading the sprite
+    int rows = SCREEN_H - (v[in.y] & (SCREEN_H - 1));
+    if (out_of_memory(index_register, in.n < rows ? in.n : rows)) {
+      return "sprite read outside memory";
+    }
+  } else if (in.type == 0xF && in.nn == 0x33 &&
+             out_of_memory(index_register, 3)) {
+    return "FX33 write outside memory";
+  } else if (in.type == 0xF && in.nn == 0x55 &&
+             out_of_memory(index_register, in.x + 1)) {
+    return "FX55 write outside memory";
+  } else if (in.type == 0xF && in.nn == 0x65 &&
+             out_of_memory(index_register, in.x + 1)) {
+    return "FX65 read outside memory";
+  }
+
+  return NULL;
+}
+
+// memory and screen hashes and screen_rows are kept incrementally, they must
+// match a full recomputation
+static const char *check_hashes() {
+  uint64_t memory_before = memory_hash;
+  uint64_t screen_before = screen_hash;
+  uint64_t rows_before[SCREEN_H];
+  memcpy(rows_before, screen_rows, sizeof(screen_rows));
+  rehash_machine();
+
+  if (memory_before != memory_hash) {
+    return "incremental memory_hash";
+  }
+  if (screen_before != screen_hash) {
+    return "incremental screen_hash";
+  }
+  if (memcmp(rows_before, screen_rows, sizeof(screen_rows)) != 0) {
+    return "incremental screen_rows";
+  }
+
+  return NULL;
+}
+
+static const char *state_difference(const MachineState *a,
+                                    const MachineState *b) {
+  if (memcmp(a->memory, b->memory, sizeof(a->memory)) != 0) {
+    return "memory";
+  }
+  if (memcmp(a->screen_state, b->screen_state, sizeof(a->screen_state))) {
+    return "screen";
+  }
+  if (a->program_counter != b->program_counter) {
+    return "pc";
+  }
+  if (a->index_register != b->index_register) {
+    return "index";
+  }
+  if (memcmp(a->v, b->v, sizeof(a->v)) != 0) {
+    return "registers";
+  }
+  if (a->functions_stack.head != b->functions_stack.head ||
+      memcmp(a->functions_stack.data, b->functions_stack.data,
+             (a->functions_stack.head + 1) * sizeof(int16_t)) != 0) {
+    return "stack";
+  }
+  if (a->delay_timer != b->delay_timer || a->audio_timer != b->audio_timer) {
+    return "timers";
+  }
+  if (a->keyboard != b->keyboard || a->key_waiting != b->key_waiting ||
+      a->key_wait_register != b->key_wait_register ||
+      a->key_wait_pressed != b->key_wait_pressed) {
+    return "keys";
+  }
+  if (a->memory_hash != b->memory_hash || a->screen_hash != b->screen_hash) {
+    return "hashes";
+  }
+  if (a->self_jump != b->self_jump) {
+    return "self_jump";
+  }
+  if (a->faulted != b->faulted) {
+    return "faulted";
+  }
+  if (a->random_state != b->random_state) {
+    return "random_state";
+  }
+
+  return NULL;
+}
+
+static void load_case(const FuzzCase *fuzz_case) {
+  reset_machine();
+  legacy_mode = fuzz_case->legacy_mode;
+  seed_random(fuzz_case->seed);
+  memcpy(memory + PROGRAM_START, fuzz_case->rom, fuzz_case->size);
+  rehash_machine();
+}
+
+// every engine sees the same keys and timer ticks at the same instruction
+static const char *run_steps(const Engine *engine, uint64_t seed,
+                             uint64_t *step, int count) {
+  for (int i = 0; i < count; ++i, ++*step) {
+    if (*step % FUZZ_KEYS_EVERY == 0) {
+      uint64_t bits = mix_hash(seed ^ *step);
+      set_keys(bits & 1 ? 1 << ((bits >> 1) & 0xF) : 0);
+    }
+
+    if (*step % FUZZ_TIMER_EVERY == 0) {
+      tick_timers();
+    }
+
+    const char *fault = predict_fault();
+    if (fault) {
+      return fault;
+    }
+
+    engine->execute();
+  }
+
+  return NULL;
+}
+
+// runs every engine from the same checkpoint for compare_every instructions
+// and compares them with the reference, until max_steps or a failure
+static Outcome run_case(const FuzzCase *fuzz_case, uint64_t max_steps,
+                        int compare_every) {
+  static MachineState checkpoint;
+  static MachineState reference;
+  static MachineState other;
+  Outcome outcome = {OUTCOME_OK, NULL, NULL, 0};
+
+  load_case(fuzz_case);
+  save_machine(&checkpoint);
+
+  for (uint64_t start = 0; start < max_steps; start += compare_every) {
+    uint64_t step = start;
+    OutcomeKind kind = OUTCOME_FAULT;
+    const char *fault =
+        run_steps(&engines[0], fuzz_case->seed, &step, compare_every);
+    if (fault == NULL) {
+      kind = OUTCOME_DIVERGENCE;
+      fault = check_hashes();
+    }
+
+    if (fault) {
+      outcome.kind = kind;
+      outcome.what = fault;
+      outcome.engine = engines[0].name;
+      outcome.step = step;
+      return outcome;
+    }
+
+    save_machine(&reference);
+    bool halted = self_jump || faulted;
+
+    for (int e = 1; e < ENGINES_COUNT; ++e) {
+      load_machine(&checkpoint);
+      step = start;
+
+      // a fault the reference did not hit is a divergence as well
+      const char *difference =
+          run_steps(&engines[e], fuzz_case->seed, &step, compare_every);
+      if (difference == NULL) {
+        save_machine(&other);
+        difference = state_difference(&reference, &other);
+      }
+
+      if (difference) {
+        outcome.kind = OUTCOME_DIVERGENCE;
+        outcome.what = difference;
+        outcome.engine = engines[e].name;
+        outcome.step = start;
+        return outcome;
+      }
+    }
+
+    outcome.step = step;
+
+    // a rom jumping to itself or faulted can not reach anything new
+    if (halted) {
+      break;
+    }
+
+    checkpoint = reference;
+  }
+
+  return outcome;
+}
+
+static bool same_failure(const Outcome *a, const Outcome *b) {
+  return a->kind == b->kind && strcmp(a->what, b->what) == 0 &&
+         strcmp(a->engine, b->engine) == 0;
+}
+
+// shrinks the failing case: first to the exact instruction, then clears ever
+// smaller blocks of the rom (0000 does nothing) while the failure stays the
+// same, then drops the zeros at the end
+static void minimize(FuzzCase *fuzz_case, Outcome *failure,
+                     uint64_t max_steps) {
+  static FuzzCase trial;
+
+  Outcome exact = run_case(fuzz_case, max_steps, 1);
+  if (same_failure(&exact, failure)) {
+    *failure = exact;
+  }
+  uint64_t steps = failure->step + 1;
+
+  for (size_t block = fuzz_case->size / 2; block >= 1; block /= 2) {
+    for (size_t start = 0; start < fuzz_case->size; start += block) {
+      size_t length = block;
+      if (start + length > fuzz_case->size) {
+        length = fuzz_case->size - start;
+      }
+
+      trial = *fuzz_case;
+      memset(trial.rom + start, 0, length);
+      if (memcmp(trial.rom + start, fuzz_case->rom + start, length) == 0) {
+        continue;
+      }
+
+      Outcome outcome = run_case(&trial, steps, steps);
+      if (same_failure(&outcome, failure)) {
+        *fuzz_case = trial;
+      }
+    }
+  }
+
+  while (fuzz_case->size > 0 && fuzz_case->rom[fuzz_case->size - 1] == 0) {
+    --fuzz_case->size;
+  }
+
+  exact = run_case(fuzz_case, steps, 1);
+  if (same_failure(&exact, failure)) {
+    *failure = exact;
+  }
+}
+
+typedef struct seeds {
+  int count;
+  size_t sizes[FUZZ_MAX_SEEDS];
+  uint8_t roms[FUZZ_MAX_SEEDS][FUZZ_ROM_SIZE];
+} Seeds;
+
+static void load_seeds(Seeds *seeds, const char *directory) {
+  seeds->count = 0;
+  DIR *dir = opendir(directory);
+  if (dir == NULL) {
+    printf("no seed roms in %s, generating only\n", directory);
+    return;
+  }
+
+  struct dirent *file;
+  while ((file = readdir(dir)) != NULL && seeds->count < FUZZ_MAX_SEEDS) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", directory, file->d_name);
+    if (file->d_name[0] == '.') {
+      continue;
+    }
+
+    FILE *rom = fopen(path, "rb");
+    if (rom == NULL) {
+      continue;
+    }
+
+    size_t size = fread(seeds->roms[seeds->count], 1, FUZZ_ROM_SIZE, rom);
+    fclose(rom);
+    if (size > 0) {
+      seeds->sizes[seeds->count++] = size;
+    }
+  }
+
+  closedir(dir);
+}
+
+// random bytes, random instructions whose jumps and calls land inside the
+// rom, or a seed rom with a few mutations
+static void generate_case(FuzzCase *fuzz_case, const Seeds *seeds,
+                          uint64_t *state) {
+  fuzz_case->seed = next_random(state);
+  fuzz_case->legacy_mode = fuzz_case->seed & 1;
+
+  int strategy = next_random(state) % (seeds->count > 0 ? 3 : 2);
+  if (strategy == 0 || strategy == 1) {
+    fuzz_case->size = 2 + (next_random(state) % 511 & ~1);
+    for (size_t i = 0; i < fuzz_case->size; i += 2) {
+      uint16_t op_code = next_random(state);
+      uint8_t type = op_code >> 12;
+      if (strategy == 1 && (type == 0x1 || type == 0x2 || type == 0xB)) {
+        op_code = (op_code & 0xF000) |
+                  (PROGRAM_START + (next_random(state) % fuzz_case->size & ~1));
+      }
+
+      fuzz_case->rom[i] = op_code >> 8;
+      fuzz_case->rom[i + 1] = op_code & 0xFF;
+    }
+    return;
+  }
+
+  int seed = next_random(state) % seeds->count;
+  fuzz_case->size = seeds->sizes[seed];
+  memcpy(fuzz_case->rom, seeds->roms[seed], fuzz_case->size);
+
+  int mutations = 1 + next_random(state) % 8;
+  for (int i = 0; i < mutations; ++i) {
+    uint64_t bits = next_random(state);
+    size_t at = bits % fuzz_case->size;
+
+    switch ((bits >> 32) % 3) {
+    case 0:
+      fuzz_case->rom[at] ^= 1 << ((bits >> 40) & 7);
+      break;
+    case 1:
+      fuzz_case->rom[at] = bits >> 40;
+      break;
+    case 2: {
+      size_t from = (bits >> 40) % fuzz_case->size;
+      size_t length = 2 + (bits >> 56) % 31;
+      if (at + length <= fuzz_case->size && from + length <= fuzz_case->size) {
+        memmove(fuzz_case->rom + at, fuzz_case->rom + from, length);
+      }
+      break;
+    }
+    }
+  }
+}
+
+static void report(const FuzzCase *fuzz_case, const Outcome *failure,
+                   const char *output_directory, int index) {
+  printf("%s: %s in %s engine at instruction %" PRIu64
+         ", %zu byte rom, seed 0x%016" PRIx64 ", %s mode\n",
+         failure->kind == OUTCOME_FAULT ? "fault" : "divergence",
+         failure->what, failure->engine, failure->step, fuzz_case->size,
+         fuzz_case->seed, fuzz_case->legacy_mode ? "legacy" : "modern");
+
+  // what is left after minimizing, the cleared instructions are skipped
+  int shown = 0;
+  for (size_t i = 0; i < fuzz_case->size && shown < 32; i += 2) {
+    uint8_t low = i + 1 < fuzz_case->size ? fuzz_case->rom[i + 1] : 0;
+    if (fuzz_case->rom[i] != 0 || low != 0) {
+      printf("  0x%03zX  %02X%02X\n", PROGRAM_START + i, fuzz_case->rom[i],
+             low);
+      ++shown;
+    }
+  }
+
+  if (output_directory == NULL) {
+    return;
+  }
+
+  char path[1024];
+  snprintf(path, sizeof(path), "%s/fuzz-%02d-%016" PRIx64 ".ch8",
+           output_directory, index, fuzz_case->seed);
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    printf("could not write %s\n", path);
+    return;
+  }
+
+  fwrite(fuzz_case->rom, 1, fuzz_case->size, file);
+  fclose(file);
+  printf("  written to %s\n", path);
+}
+
+static uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// differential fuzzer: every engine runs the same generated roms with the
+// same keys, and must end up in the same state as execute_cycle
+int main(int argc, char *argv[]) {
+  static FuzzCase fuzz_case;
+  static Seeds seeds;
+  char *seed_directory = "roms";
+  char *output_directory = NULL;
+  char *replay_path = NULL;
+  uint64_t cases = 10000;
+  uint64_t max_steps = 20000;
+  int compare_every = 64;
+  uint64_t state = time(NULL);
+  uint64_t replay_seed = 0;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      cases = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+      max_steps = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+      compare_every = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      state = strtoull(argv[++i], NULL, 0);
+      replay_seed = state;
+    } else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output_directory = argv[++i];
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      replay_path = argv[++i];
+    } else if (argv[i][0] != '-') {
+      seed_directory = argv[i];
+    } else {
+      printf("usage: %s [-n cases] [-i instructions] [-c compare every] "
+             "[-s seed] [-o output dir] [-r rom] [seed rom dir]\n",
+             argv[0]);
+      return 1;
+    }
+  }
+
+  if (compare_every < 1) {
+    compare_every = 1;
+  }
+
+  // a reproducer found earlier: rerun it with the seed it was reported with
+  if (replay_path != NULL) {
+    FILE *rom = fopen(replay_path, "rb");
+    if (rom == NULL) {
+      printf("error while opening file\n");
+      return 1;
+    }
+
+    fuzz_case.size = fread(fuzz_case.rom, 1, FUZZ_ROM_SIZE, rom);
+    fclose(rom);
+    fuzz_case.seed = replay_seed;
+    for (int mode = 0; mode < 2; ++mode) {
+      fuzz_case.legacy_mode = mode;
+      Outcome outcome = run_case(&fuzz_case, max_steps, 1);
+      if (outcome.kind == OUTCOME_OK) {
+        printf("%s mode: no failure in %" PRIu64 " instructions\n",
+               mode ? "legacy" : "modern", max_steps);
+      } else {
+        report(&fuzz_case, &outcome, NULL, 0);
+      }
+    }
+    return 0;
+  }
+
+  load_seeds(&seeds, seed_directory);
+  printf("fuzzing %d engines, %d seed roms, seed 0x%016" PRIx64 "\n",
+         ENGINES_COUNT, seeds.count, state);
+
+  Outcome findings[FUZZ_MAX_FINDINGS];
+  int findings_count = 0;
+  uint64_t instructions = 0;
+  uint64_t start = now_ns();
+
+  for (uint64_t i = 0; i < cases; ++i) {
+    generate_case(&fuzz_case, &seeds, &state);
+    Outcome outcome = run_case(&fuzz_case, max_steps, compare_every);
+    instructions += outcome.step;
+    if (outcome.kind == OUTCOME_OK) {
+      continue;
+    }
+
+    // every kind of failure is reported once
+    bool known = false;
+    for (int f = 0; f < findings_count; ++f) {
+      known |= same_failure(&findings[f], &outcome);
+    }
+    if (known || findings_count == FUZZ_MAX_FINDINGS) {
+      continue;
+    }
+
+    findings[findings_count++] = outcome;
+    minimize(&fuzz_case, &outcome, max_steps);
+    report(&fuzz_case, &outcome, output_directory, findings_count);
+  }
+
+  double seconds = (now_ns() - start) / 1e9;
+  printf("%" PRIu64 " cases, %" PRIu64 " instructions per engine, %.0f "
+         "cases/s, %d distinct failures\n",
+         cases, instructions, cases / seconds, findings_count);
+
+  return findings_count > 0 ? 2 : 0;
+}
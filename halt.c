@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "halt.h"
+
+void halt_init(HaltDetector *detector) {
+  memset(detector, 0, sizeof(HaltDetector));
+}
+
+static void save_state(HaltDetector *detector, uint64_t hash, uint64_t frame) {
+  detector->has_saved = true;
+  detector->saved_hash = hash;
+  detector->saved_frame = frame;
+}
+
+// call once per frame
+HaltReason halt_check(HaltDetector *detector, uint64_t frame) {
+  if (self_jump) {
+    detector->period = 1;
+    return HALT_SELF_JUMP;
+  }
+
+  uint64_t hash = machine_state_hash();
+
+  if (!detector->has_saved) {
+    save_state(detector, hash, frame);
+    detector->power = 1;
+    return HALT_NONE;
+  }
+
+  if (hash == detector->saved_hash) {
+    detector->period = frame - detector->saved_frame;
+    return HALT_STATE_REPEAT;
+  }
+
+  if (frame - detector->saved_frame >= detector->power) {
+    save_state(detector, hash, frame);
+    detector->power *= 2;
+  }
+
+  return HALT_NONE;
+}
+
+const char *halt_reason_name(HaltReason reason) {
+  switch (reason) {
+  case HALT_SELF_JUMP:
+    return "jump to self";
+  case HALT_STATE_REPEAT:
+    return "machine state repeated";
+  case HALT_FAULT:
+    return "stack fault";
+  default:
+    return "running";
+  }
+}
@@ -0,0 +1,29 @@
+#ifndef HALT_H
+#define HALT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef enum halt_reason {
+  HALT_NONE,
+  HALT_SELF_JUMP,   // a 1NNN instruction jumped to itself
+  HALT_STATE_REPEAT, // the whole machine state came back to an earlier one
+  HALT_FAULT         // the stack overflowed or underflowed, see faulted
+} HaltReason;
+
+// finds permanent loops by comparing the machine state hash at frame
+// boundaries (brent's cycle detection). a repeat only proves a loop when the
+// input does not change anymore, so it is meant for runs without live input.
+typedef struct halt_detector {
+  bool has_saved;
+  uint64_t saved_hash;
+  uint64_t saved_frame;
+  uint64_t power;  // frames to wait before moving the saved state
+  uint64_t period; // loop length in frames, once detected
+} HaltDetector;
+
+void halt_init(HaltDetector *detector);
+HaltReason halt_check(HaltDetector *detector, uint64_t frame);
+const char *halt_reason_name(HaltReason reason);
+
+#endif // !HALT_H
@@ -0,0 +1,151 @@
+#include <SDL3/SDL.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "input.h"
+
+typedef struct default_key {
+  SDL_Scancode scancode;
+  int8_t key;
+} DefaultKey;
+
+// the cosmac vip keypad laid over the left side of a qwerty keyboard
+static const DefaultKey default_keys[] = {
+    {SDL_SCANCODE_1, 0x1}, {SDL_SCANCODE_2, 0x2}, {SDL_SCANCODE_3, 0x3},
+    {SDL_SCANCODE_4, 0xC}, {SDL_SCANCODE_Q, 0x4}, {SDL_SCANCODE_W, 0x5},
+    {SDL_SCANCODE_E, 0x6}, {SDL_SCANCODE_R, 0xD}, {SDL_SCANCODE_A, 0x7},
+    {SDL_SCANCODE_S, 0x8}, {SDL_SCANCODE_D, 0x9}, {SDL_SCANCODE_F, 0xE},
+    {SDL_SCANCODE_Z, 0xA}, {SDL_SCANCODE_X, 0x0}, {SDL_SCANCODE_C, 0xB},
+    {SDL_SCANCODE_V, 0xF},
+};
+
+void input_init(Input *input) {
+  memset(input, 0, sizeof(Input));
+  memset(input->scancode_keys, INPUT_UNMAPPED, sizeof(input->scancode_keys));
+  memset(input->button_keys, INPUT_UNMAPPED, sizeof(input->button_keys));
+
+  for (size_t i = 0; i < SDL_arraysize(default_keys); ++i) {
+    input->scancode_keys[default_keys[i].scancode] = default_keys[i].key;
+  }
+
+  input->button_keys[SDL_GAMEPAD_BUTTON_DPAD_UP] = 0x2;
+  input->button_keys[SDL_GAMEPAD_BUTTON_DPAD_LEFT] = 0x4;
+  input->button_keys[SDL_GAMEPAD_BUTTON_DPAD_RIGHT] = 0x6;
+  input->button_keys[SDL_GAMEPAD_BUTTON_DPAD_DOWN] = 0x8;
+  input->button_keys[SDL_GAMEPAD_BUTTON_SOUTH] = 0x5;
+}
+
+bool input_load_keymap(Input *input, const char *path) {
+  FILE *keymap = fopen(path, "r");
+  if (keymap == NULL) {
+    printf("could not open keymap %s\n", path);
+    return false;
+  }
+
+  char line[256];
+  int line_number = 0;
+  while (fgets(line, sizeof(line), keymap) != NULL) {
+    ++line_number;
+    line[strcspn(line, "#\n")] = '\0';
+
+    char kind[16];
+    char name[64];
+    unsigned key;
+    int fields = sscanf(line, "%15s %63s %x", kind, name, &key);
+    if (fields <= 0) {
+      continue;
+    }
+
+    bool mapped = false;
+    if (fields == 3 && key < 16 && strcmp(kind, "key") == 0) {
+      SDL_Scancode scancode = SDL_GetScancodeFromName(name);
+      if (scancode != SDL_SCANCODE_UNKNOWN) {
+        input->scancode_keys[scancode] = key;
+        mapped = true;
+      }
+    } else if (fields == 3 && key < 16 && strcmp(kind, "button") == 0) {
+      int button = SDL_GetGamepadButtonFromString(name);
+      if (button >= 0 && button < SDL_GAMEPAD_BUTTON_COUNT) {
+        input->button_keys[button] = key;
+        mapped = true;
+      }
+    }
+
+    if (!mapped) {
+      printf("%s:%d: ignoring invalid mapping\n", path, line_number);
+    }
+  }
+
+  fclose(keymap);
+  return true;
+}
+
+static void set_bit(uint16_t *keys, int8_t key, bool down) {
+  if (key == INPUT_UNMAPPED) {
+    return;
+  }
+
+  if (down) {
+    *keys |= 1 << key;
+  } else {
+    *keys &= ~(1 << key);
+  }
+}
+
+bool input_handle_event(Input *input, const SDL_Event *event) {
+  uint16_t before = input_keys(input);
+
+  switch (event->type) {
+  case SDL_EVENT_KEY_DOWN:
+  case SDL_EVENT_KEY_UP:
+    if (event->key.scancode < SDL_SCANCODE_COUNT) {
+      set_bit(&input->keyboard_keys,
+              input->scancode_keys[event->key.scancode], event->key.down);
+    }
+    break;
+  case SDL_EVENT_GAMEPAD_BUTTON_DOWN:
+  case SDL_EVENT_GAMEPAD_BUTTON_UP:
+    if (event->gbutton.button < SDL_GAMEPAD_BUTTON_COUNT) {
+      set_bit(&input->gamepad_keys, input->button_keys[event->gbutton.button],
+              event->gbutton.down);
+    }
+    break;
+  case SDL_EVENT_GAMEPAD_ADDED:
+    // a single gamepad is used, the first one plugged in
+    if (input->gamepad == NULL) {
+      input->gamepad = SDL_OpenGamepad(event->gdevice.which);
+    }
+    break;
+  case SDL_EVENT_GAMEPAD_REMOVED:
+    if (input->gamepad &&
+        SDL_GetGamepadID(input->gamepad) == event->gdevice.which) {
+      SDL_CloseGamepad(input->gamepad);
+      input->gamepad = NULL;
+      input->gamepad_keys = 0;
+    }
+    break;
+  default:;
+  }
+
+  input->latched_keys |= input_keys(input);
+  return input_keys(input) != before;
+}
+
+uint16_t input_keys(Input *input) {
+  return input->keyboard_keys | input->gamepad_keys;
+}
+
+uint16_t input_sample(Input *input) {
+  uint16_t keys = input_keys(input) | input->latched_keys;
+  input->latched_keys = 0;
+
+  return keys;
+}
+
+void input_close(Input *input) {
+  if (input->gamepad) {
+    SDL_CloseGamepad(input->gamepad);
+    input->gamepad = NULL;
+  }
+}
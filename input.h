@@ -0,0 +1,39 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <SDL3/SDL.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define INPUT_UNMAPPED -1
+
+// maps keyboard scancodes and gamepad buttons to the 16 chip-8 keys
+typedef struct input {
+  int8_t scancode_keys[SDL_SCANCODE_COUNT];
+  int8_t button_keys[SDL_GAMEPAD_BUTTON_COUNT];
+
+  // tracked apart so a key held on both devices stays down until both let go
+  uint16_t keyboard_keys;
+  uint16_t gamepad_keys;
+  uint16_t latched_keys; // seen down since the last input_sample
+
+  SDL_Gamepad *gamepad;
+} Input;
+
+// default layout: 1234 / QWER / ASDF / ZXCV by position, d-pad on 2 4 6 8
+void input_init(Input *input);
+
+// lines of "key <scancode name> <hex key>" or "button <button name> <hex
+// key>", # starts a comment. mappings not in the file keep their default.
+bool input_load_keymap(Input *input, const char *path);
+
+// returns true when the held chip-8 keys changed
+bool input_handle_event(Input *input, const SDL_Event *event);
+uint16_t input_keys(Input *input);
+
+// the held keys and every key pressed since the previous sample, so a press
+// and release between two samples still shows up as down once
+uint16_t input_sample(Input *input);
+void input_close(Input *input);
+
+#endif // !INPUT_H
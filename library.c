@@ -0,0 +1,305 @@
+#include <dirent.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <libgen.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cfg.h"
+#include "chip8.h"
+#include "library.h"
+
+static const char *platform_names[] = {"chip8", "schip", "xochip",
+                                       "unknown"};
+
+const char *platform_name(Platform platform) {
+  return platform_names[platform];
+}
+
+static bool parse_platform(const char *name, Platform *platform) {
+  for (int i = 0; i < 4; ++i) {
+    if (strcmp(name, platform_names[i]) == 0) {
+      *platform = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static uint64_t hash_bytes(const uint8_t *bytes, size_t size) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 0x100000001B3ULL;
+  }
+
+  return hash;
+}
+
+static void index_path(const char *directory, char *path, size_t size) {
+  snprintf(path, size, "%s/%s", directory, LIBRARY_INDEX_NAME);
+}
+
+// look at the reachable code only, sprite data would give false positives.
+// a rom the analyzer rejects is listed as unknown, the scan goes on.
+static Platform detect_platform(Cfg *cfg, const uint8_t *rom, size_t size) {
+  if (size > MEMSIZE - PROGRAM_START) {
+    return PLATFORM_XOCHIP;
+  }
+  if (!cfg_analyze(cfg, rom, size)) {
+    return PLATFORM_UNKNOWN;
+  }
+
+  Platform platform = PLATFORM_CHIP8;
+  for (int address = PROGRAM_START; address < MEMSIZE; ++address) {
+    if (!cfg->instruction_start[address]) {
+      continue;
+    }
+
+    uint16_t op_code = (cfg->image[address] << 8) | cfg->image[address + 1];
+    Instruction in = decode_instruction(op_code);
+
+    bool xochip = (in.type == 0x5 && (in.n == 0x2 || in.n == 0x3)) ||
+                  in.op_code == 0xF000 || in.op_code == 0xF002 ||
+                  (in.type == 0xF && (in.nn == 0x01 || in.nn == 0x3A));
+    if (xochip) {
+      return PLATFORM_XOCHIP;
+    }
+
+    bool schip = (in.type == 0x0 && in.x == 0x0 &&
+                  ((in.nn & 0xF0) == 0xC0 || in.nn >= 0xFB)) ||
+                 (in.type == 0xD && in.n == 0x0) ||
+                 (in.type == 0xF &&
+                  (in.nn == 0x30 || in.nn == 0x75 || in.nn == 0x85));
+    if (schip) {
+      platform = PLATFORM_SCHIP;
+    }
+  }
+
+  return platform;
+}
+
+// unknown roms get the emulator defaults
+static void recommend_settings(RomEntry *entry) {
+  bool chip8 = entry->platform == PLATFORM_CHIP8 ||
+               entry->platform == PLATFORM_UNKNOWN;
+  entry->legacy_mode = chip8;
+  entry->ips = chip8 ? CPU_FREQUENCY : 1000;
+}
+
+// map the file, hash it and detect what it needs to run
+static bool index_file(RomEntry *entry, const char *path, Cfg *cfg) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1) {
+    return false;
+  }
+
+  if (entry->size == 0) {
+    entry->hash = hash_bytes(NULL, 0);
+    entry->platform = PLATFORM_CHIP8;
+    close(fd);
+    recommend_settings(entry);
+    return true;
+  }
+
+  uint8_t *rom = mmap(NULL, entry->size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (rom == MAP_FAILED) {
+    return false;
+  }
+
+  entry->hash = hash_bytes(rom, entry->size);
+  entry->platform = detect_platform(cfg, rom, entry->size);
+  recommend_settings(entry);
+  munmap(rom, entry->size);
+
+  return true;
+}
+
+static int compare_entries(const void *a, const void *b) {
+  return strcmp(((const RomEntry *)a)->name, ((const RomEntry *)b)->name);
+}
+
+// reads the index only, missing or broken indexes give an empty library
+bool library_load(Library *library, const char *directory) {
+  library->entries_count = 0;
+  snprintf(library->directory, sizeof(library->directory), "%s", directory);
+
+  char path[600];
+  index_path(directory, path, sizeof(path));
+  FILE *index = fopen(path, "r");
+  if (index == NULL) {
+    return false;
+  }
+
+  int version;
+  if (fscanf(index, "chip8-index %d\n", &version) != 1 ||
+      version != LIBRARY_INDEX_VERSION) {
+    fclose(index);
+    return false;
+  }
+
+  char line[LIBRARY_NAME_SIZE + 128];
+  while (fgets(line, sizeof(line), index) != NULL &&
+         library->entries_count < LIBRARY_MAX_ENTRIES) {
+    RomEntry *entry = &library->entries[library->entries_count];
+    char platform[16];
+    char profile[16];
+    int name_start;
+
+    if (sscanf(line, "%" SCNx64 " %" SCNu32 " %" SCNd64 " %15s %15s %d %n",
+               &entry->hash, &entry->size, &entry->mtime, platform, profile,
+               &entry->ips, &name_start) != 6 ||
+        !parse_platform(platform, &entry->platform)) {
+      continue;
+    }
+
+    line[strcspn(line, "\n")] = '\0';
+    snprintf(entry->name, sizeof(entry->name), "%s", line + name_start);
+    entry->legacy_mode = strcmp(profile, "legacy") == 0;
+    ++library->entries_count;
+  }
+
+  fclose(index);
+  return true;
+}
+
+// brings the index up to date with the directory. files whose size and
+// modification time did not change are not opened again.
+bool library_scan(Library *library, const char *directory) {
+  Library *previous = malloc(sizeof(Library));
+  Cfg *cfg = malloc(sizeof(Cfg));
+  DIR *dir = opendir(directory);
+  if (previous == NULL || cfg == NULL || dir == NULL) {
+    printf("could not scan %s\n", directory);
+    free(previous);
+    free(cfg);
+    if (dir) {
+      closedir(dir);
+    }
+    return false;
+  }
+
+  library_load(previous, directory);
+  library->entries_count = 0;
+  snprintf(library->directory, sizeof(library->directory), "%s", directory);
+
+  struct dirent *file;
+  while ((file = readdir(dir)) != NULL &&
+         library->entries_count < LIBRARY_MAX_ENTRIES) {
+    char path[1024];
+    struct stat info;
+
+    snprintf(path, sizeof(path), "%s/%s", directory, file->d_name);
+    if (file->d_name[0] == '.' || strlen(file->d_name) >= LIBRARY_NAME_SIZE ||
+        stat(path, &info) == -1 || !S_ISREG(info.st_mode)) {
+      continue;
+    }
+
+    RomEntry *entry = &library->entries[library->entries_count];
+    RomEntry *known = library_find(previous, file->d_name);
+    if (known != NULL && known->size == (uint32_t)info.st_size &&
+        known->mtime == (int64_t)info.st_mtime) {
+      *entry = *known;
+      ++library->entries_count;
+      continue;
+    }
+
+    memset(entry, 0, sizeof(RomEntry));
+    snprintf(entry->name, sizeof(entry->name), "%s", file->d_name);
+    entry->size = info.st_size;
+    entry->mtime = info.st_mtime;
+    if (index_file(entry, path, cfg)) {
+      ++library->entries_count;
+    }
+  }
+
+  closedir(dir);
+  free(cfg);
+  free(previous);
+
+  qsort(library->entries, library->entries_count, sizeof(RomEntry),
+        compare_entries);
+
+  return library_save(library);
+}
+
+// written next to the roms, one rom per line with the name last since it can
+// contain spaces
+bool library_save(Library *library) {
+  char path[600];
+  char temporary_path[610];
+  index_path(library->directory, path, sizeof(path));
+  snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+  FILE *index = fopen(temporary_path, "w");
+  if (index == NULL) {
+    printf("could not write %s\n", temporary_path);
+    return false;
+  }
+
+  fprintf(index, "chip8-index %d\n", LIBRARY_INDEX_VERSION);
+  for (int i = 0; i < library->entries_count; ++i) {
+    RomEntry *entry = &library->entries[i];
+    fprintf(index, "%016" PRIx64 " %" PRIu32 " %" PRId64 " %s %s %d %s\n",
+            entry->hash, entry->size, entry->mtime,
+            platform_name(entry->platform),
+            entry->legacy_mode ? "legacy" : "modern", entry->ips, entry->name);
+  }
+
+  fclose(index);
+
+  // replace the old index in one step so readers never see half of it
+  return rename(temporary_path, path) == 0;
+}
+
+RomEntry *library_find(Library *library, const char *name) {
+  for (int i = 0; i < library->entries_count; ++i) {
+    if (strcmp(library->entries[i].name, name) == 0) {
+      return &library->entries[i];
+    }
+  }
+
+  return NULL;
+}
+
+void library_print(Library *library) {
+  for (int i = 0; i < library->entries_count; ++i) {
+    RomEntry *entry = &library->entries[i];
+    printf("%016" PRIx64 " %6" PRIu32 " %-6s %-6s %4d  %s\n", entry->hash,
+           entry->size, platform_name(entry->platform),
+           entry->legacy_mode ? "legacy" : "modern", entry->ips, entry->name);
+  }
+}
+
+bool library_apply(const char *rom_path) {
+  char directory_buffer[1024];
+  char name_buffer[1024];
+  snprintf(directory_buffer, sizeof(directory_buffer), "%s", rom_path);
+  snprintf(name_buffer, sizeof(name_buffer), "%s", rom_path);
+
+  struct stat info;
+  Library *library = malloc(sizeof(Library));
+  if (library == NULL || stat(rom_path, &info) == -1 ||
+      !library_load(library, dirname(directory_buffer))) {
+    free(library);
+    return false;
+  }
+
+  RomEntry *entry = library_find(library, basename(name_buffer));
+  bool found = entry != NULL && entry->size == (uint32_t)info.st_size &&
+               entry->mtime == (int64_t)info.st_mtime;
+  if (found) {
+    legacy_mode = entry->legacy_mode;
+    cpu_frequency = entry->ips;
+  }
+
+  free(library);
+  return found;
+}
@@ -0,0 +1,46 @@
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LIBRARY_INDEX_NAME ".chip8-index"
+#define LIBRARY_INDEX_VERSION 1
+#define LIBRARY_MAX_ENTRIES 1024
+#define LIBRARY_NAME_SIZE 256
+
+typedef enum platform {
+  PLATFORM_CHIP8,
+  PLATFORM_SCHIP,   // uses super-chip instructions
+  PLATFORM_XOCHIP,  // uses xo-chip instructions or does not fit in 4k
+  PLATFORM_UNKNOWN, // the analysis failed, listed with the defaults
+} Platform;
+
+typedef struct rom_entry {
+  char name[LIBRARY_NAME_SIZE]; // file name inside the library directory
+  uint64_t hash;                // fnv-1a of the contents
+  uint32_t size;
+  int64_t mtime; // used to skip unchanged files when rescanning
+  Platform platform;
+  bool legacy_mode; // recommended quirk profile
+  int ips;          // recommended instructions per second
+} RomEntry;
+
+typedef struct library {
+  char directory[512];
+  int entries_count;
+  RomEntry entries[LIBRARY_MAX_ENTRIES];
+} Library;
+
+bool library_load(Library *library, const char *directory);
+bool library_scan(Library *library, const char *directory);
+bool library_save(Library *library);
+RomEntry *library_find(Library *library, const char *name);
+void library_print(Library *library);
+const char *platform_name(Platform platform);
+
+// look the rom up in the index of its directory and apply the recommended
+// settings. only stats the file, the rom is neither read nor hashed.
+bool library_apply(const char *rom_path);
+
+#endif // !LIBRARY_H
@@ -1,34 +1,153 @@
 #include <SDL3/SDL.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#include "chip8.h"
+#include "debug.h"
+#include "env.h"
+#include "export.h"
+#include "input.h"
+#include "library.h"
 #include "main.h"
-#include "stack.h"
+#include "netplay.h"
+#include "record.h"
+#include "scale.h"
 
 int main(int argc, char *argv[]) {
-  stack_init(&functions_stack, 128);
-  init_emulator(argc > 1 ? argv[1] : NULL);
+  char *rom_name = NULL;
+  char *export_name = NULL;
+  char *record_path = NULL;
+  char *debug_socket = NULL;
+  char *library_directory = NULL;
+  char *keymap_path = NULL;
+  int netplay_port = 0;
+  int netplay_peer_port = 0;
+  int netplay_latency = 0;
+  int netplay_loss = 0;
+  RecordFormat record_format = RECORD_Y4M;
+  TimingProfile timing = TIMING_MODERN;
+  int record_scale = 1;
+  bool headless = false;
+  bool detect_halt = true;
+  uint64_t headless_frames = 60 * TIMER_FREQUENCY;
+
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--export") == 0 && i + 1 < argc) {
+      export_name = argv[++i];
+    } else if (strcmp(argv[i], "--library") == 0 && i + 1 < argc) {
+      library_directory = argv[++i];
+    } else if (strcmp(argv[i], "--netplay") == 0 && i + 2 < argc) {
+      netplay_port = atoi(argv[++i]);
+      netplay_peer_port = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--net-latency") == 0 && i + 1 < argc) {
+      netplay_latency = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--net-loss") == 0 && i + 1 < argc) {
+      netplay_loss = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--keymap") == 0 && i + 1 < argc) {
+      keymap_path = argv[++i];
+    } else if (strcmp(argv[i], "--debug") == 0 && i + 1 < argc) {
+      debug_socket = argv[++i];
+    } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+      record_path = argv[++i];
+    } else if (strcmp(argv[i], "--record-format") == 0 && i + 1 < argc) {
+      if (!record_parse_format(argv[++i], &record_format)) {
+        printf("unknown recording format %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--record-scale") == 0 && i + 1 < argc) {
+      record_scale = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--scale-mode") == 0 && i + 1 < argc) {
+      if (!scale_parse_mode(argv[++i], &scale_mode)) {
+        printf("unknown scale mode %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--timing") == 0 && i + 1 < argc) {
+      if (!parse_timing(argv[++i], &timing)) {
+        printf("unknown timing profile %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--display-wait") == 0) {
+      display_wait = true;
+    } else if (strcmp(argv[i], "--headless") == 0) {
+      headless = true;
+    } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+      headless_frames = strtoull(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "--no-halt-detection") == 0) {
+      detect_halt = false;
+    } else {
+      rom_name = argv[i];
+    }
+  }
+
+  if (library_directory != NULL) {
+    return index_library(library_directory) ? 0 : 1;
+  }
+
+  // settings recommended by the index of the rom directory, if there is one
+  if (rom_name != NULL && library_apply(rom_name)) {
+    printf("using library settings: %s, %d instructions per second\n",
+           legacy_mode ? "legacy" : "modern", cpu_frequency);
+  }
+  timing_profile = timing;
+
+  FrameExport frame_export;
+  bool exporting = false;
+  if (export_name != NULL) {
+    exporting = export_create(&frame_export, export_name);
+  }
+
+  Recorder *recorder = NULL;
+  if (record_path != NULL) {
+    recorder = malloc(sizeof(Recorder));
+    if (recorder == NULL ||
+        !record_start(recorder, record_path, record_format, record_scale)) {
+      free(recorder);
+      recorder = NULL;
+    }
+  }
+
+  if (headless) {
+    run_headless(rom_name, headless_frames, detect_halt, recorder,
+                 exporting ? &frame_export : NULL);
+    stop_outputs(recorder, exporting ? &frame_export : NULL);
 
-  SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
+    printf("bye bye!\n");
+    return 0;
+  }
+
+  if (init_emulator(rom_name)) {
+    printf("the program has been loaded correctly\n");
+  }
+  last_time = SDL_GetPerformanceCounter();
+  frequency = (double)SDL_GetPerformanceFrequency();
+
+  SDL_InitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS |
+                    SDL_INIT_GAMEPAD);
+
+  input_init(&input);
+  if (keymap_path != NULL && !input_load_keymap(&input, keymap_path)) {
+    close_sdl(NULL, NULL);
+    return 1;
+  }
 
   SDL_Window *window;
   SDL_Renderer *renderer;
   SDL_CreateWindowAndRenderer("Chip-8 Emulator", SCREEN_W * SCALE,
-                              SCREEN_H * SCALE, SDL_WINDOW_OPENGL, &window,
-                              &renderer);
+                              SCREEN_H * SCALE,
+                              SDL_WINDOW_OPENGL | SDL_WINDOW_RESIZABLE,
+                              &window, &renderer);
 
   if (window == NULL || renderer == NULL) {
     printf("could not init window or renderer!\n");
+    stop_outputs(recorder, exporting ? &frame_export : NULL);
     close_sdl(window, renderer);
     return 1;
   }
 
-  SDL_SetRenderLogicalPresentation(renderer, SCREEN_W, SCREEN_H,
-                                   SDL_LOGICAL_PRESENTATION_LETTERBOX);
-
   SDL_AudioSpec audio_spec;
   audio_spec.channels = 1;
   audio_spec.freq = 8000;
@@ -38,44 +157,80 @@ int main(int argc, char *argv[]) {
       SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &audio_spec, NULL, NULL);
   if (!audio_stream) {
     printf("could not open audio stream\n");
+    stop_outputs(recorder, exporting ? &frame_export : NULL);
     close_sdl(window, renderer);
     exit(1);
   }
 
   // SDL_ResumeAudioStreamDevice(audio_stream);
 
+  bool debugging = false;
+  if (debug_socket != NULL) {
+    debugging = debug_start(debug_socket);
+  }
+
+  Netplay *netplay = NULL;
+  if (netplay_port != 0) {
+    netplay = malloc(sizeof(Netplay));
+    if (netplay == NULL ||
+        !netplay_start(netplay, netplay_port, netplay_peer_port,
+                       netplay_latency, netplay_loss)) {
+      free(netplay);
+      netplay = NULL;
+    }
+  }
+
   bool running = true;
   while (running) {
     uint64_t current_time = SDL_GetPerformanceCounter();
     double delta_time = (current_time - last_time) / frequency;
     last_time = current_time;
 
-    cpu_accumulator += delta_time;
     timer_accumulator += delta_time;
 
+    // with netplay the keys only reach the machine through netplay_advance
     handle_input(&running);
+    if (!netplay) {
+      set_keys(input_sample(&input));
+    }
     handle_audio(audio_stream);
 
-    while (cpu_accumulator >= CPU_INTERVAL) {
-      bool should_update_screen = execute_cycle();
-      if (should_update_screen) {
-        // render(renderer);
+    if (debugging) {
+      debug_poll();
+      if (debug_is_paused()) {
+        timer_accumulator = 0.0;
+        SDL_PauseAudioStreamDevice(audio_stream);
       }
-
-      cpu_accumulator -= CPU_INTERVAL;
     }
 
     while (timer_accumulator >= TIMER_INTERVAL) {
+      // a whole frame of instructions at once, the timers tick at its end
+      bool screen_changed = netplay
+                                ? netplay_advance(netplay, input_sample(&input))
+                                : run_frame();
+      if (screen_changed) {
+        screen_dirty = true;
+      }
+
+      // the debugger stopped the frame, wait for it before running more
+      if (debugging && debug_is_paused()) {
+        timer_accumulator = 0.0;
+      }
+
       render(renderer);
-      if (delay_timer > 0) {
-        printf("decreasing delay timer\n");
-        --delay_timer;
+      if (exporting && screen_dirty) {
+        export_publish(&frame_export, frame_count);
       }
 
+      if (recorder) {
+        record_frame(recorder, frame_count);
+      }
+
+      screen_dirty = false;
+      ++frame_count;
+
       if (audio_timer > 0) {
-        printf("decreasing audio timer\n");
         SDL_ResumeAudioStreamDevice(audio_stream);
-        --audio_timer;
       } else {
         SDL_PauseAudioStreamDevice(audio_stream);
       }
@@ -84,12 +239,94 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  if (debugging) {
+    debug_stop();
+  }
+
+  if (netplay) {
+    netplay_stop(netplay);
+    free(netplay);
+  }
+
+  stop_outputs(recorder, exporting ? &frame_export : NULL);
   close_sdl(window, renderer);
 
   printf("bye bye!\n");
   return 0;
 }
 
+bool parse_timing(const char *name, TimingProfile *timing) {
+  if (strcmp(name, "modern") == 0) {
+    *timing = TIMING_MODERN;
+  } else if (strcmp(name, "vip") == 0) {
+    *timing = TIMING_VIP;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+// run the rom as fast as possible without window, audio or input. with
+// detect_halt the run ends as soon as the rom can not make progress anymore.
+void run_headless(char *rom_name, uint64_t frames, bool detect_halt,
+                  Recorder *recorder, FrameExport *frame_export) {
+  Env env;
+  env_init(&env, 1);
+  env.detect_halt = detect_halt;
+  if (!env_reset(&env, rom_name, time(NULL))) {
+    return;
+  }
+
+  while (env.frame < frames && env.halt_reason == HALT_NONE) {
+    uint64_t frame = env.frame;
+    env_step(&env, 0);
+
+    if (frame_export && env.screen_changed) {
+      export_publish(frame_export, frame);
+    }
+
+    if (recorder) {
+      record_frame(recorder, frame);
+    }
+  }
+
+  if (env.halt_reason == HALT_FAULT) {
+    printf("stopped at frame %" PRIu64 ": %s at 0x%03X\n", env.frame,
+           halt_reason_name(env.halt_reason), program_counter);
+  } else if (env.halt_reason != HALT_NONE) {
+    printf("stopped at frame %" PRIu64 ": %s (loop of %" PRIu64 " frames)\n",
+           env.frame, halt_reason_name(env.halt_reason), env.halt.period);
+  }
+}
+
+bool index_library(char *directory) {
+  Library *library = malloc(sizeof(Library));
+  if (library == NULL) {
+    printf("error while allocating library memory\n");
+    return false;
+  }
+
+  bool indexed = library_scan(library, directory);
+  if (indexed) {
+    library_print(library);
+  }
+
+  free(library);
+  return indexed;
+}
+
+void stop_outputs(Recorder *recorder, FrameExport *frame_export) {
+  if (recorder) {
+    record_stop(recorder);
+    free(recorder);
+  }
+
+  if (frame_export) {
+    export_close(frame_export);
+  }
+}
+
 void handle_audio(SDL_AudioStream *stream) {
   const int minimum_audio =
       (8000 * sizeof(float)) /
@@ -116,134 +353,45 @@ void handle_audio(SDL_AudioStream *stream) {
   }
 }
 
+// drains every pending event before the keys are sampled, so a burst of
+// events changes the keys once. presses in the burst are latched by input.
 void handle_input(bool *running) {
   SDL_Event event;
   while (SDL_PollEvent(&event)) {
     if (event.type == SDL_EVENT_QUIT) {
       *running = false;
-      return;
-    }
-
-    if (event.type == SDL_EVENT_KEY_DOWN) {
-      switch (event.key.key) {
-      case SDLK_1:
-        keyboard[0x1] = 1;
-        break;
-      case SDLK_2:
-        keyboard[0x2] = 1;
-        break;
-      case SDLK_3:
-        keyboard[0x3] = 1;
-        break;
-      case SDLK_4:
-        keyboard[0xC] = 1;
-        break;
-      case SDLK_Q:
-        keyboard[0x4] = 1;
-        break;
-      case SDLK_W:
-        keyboard[0x5] = 1;
-        break;
-      case SDLK_E:
-        keyboard[0x6] = 1;
-        break;
-      case SDLK_R:
-        keyboard[0xD] = 1;
-        break;
-      case SDLK_A:
-        keyboard[0x7] = 1;
-        break;
-      case SDLK_S:
-        keyboard[0x8] = 1;
-        break;
-      case SDLK_D:
-        keyboard[0x9] = 1;
-        break;
-      case SDLK_F:
-        keyboard[0xE] = 1;
-        break;
-      case SDLK_Z:
-        keyboard[0xA] = 1;
-        break;
-      case SDLK_X:
-        keyboard[0x0] = 1;
-        break;
-      case SDLK_C:
-        keyboard[0xB] = 1;
-        break;
-      case SDLK_V:
-        keyboard[0xF] = 1;
-        break;
-      default:;
-      }
+      break;
     }
 
-    if (event.type == SDL_EVENT_KEY_UP) {
-      switch (event.key.key) {
-      case SDLK_1:
-        keyboard[0x1] = 0;
-        break;
-      case SDLK_2:
-        keyboard[0x2] = 0;
-        break;
-      case SDLK_3:
-        keyboard[0x3] = 0;
-        break;
-      case SDLK_4:
-        keyboard[0xC] = 0;
-        break;
-      case SDLK_Q:
-        keyboard[0x4] = 0;
-        break;
-      case SDLK_W:
-        keyboard[0x5] = 0;
-        break;
-      case SDLK_E:
-        keyboard[0x6] = 0;
-        break;
-      case SDLK_R:
-        keyboard[0xD] = 0;
-        break;
-      case SDLK_A:
-        keyboard[0x7] = 0;
-        break;
-      case SDLK_S:
-        keyboard[0x8] = 0;
-        break;
-      case SDLK_D:
-        keyboard[0x9] = 0;
-        break;
-      case SDLK_F:
-        keyboard[0xE] = 0;
-        break;
-      case SDLK_Z:
-        keyboard[0xA] = 0;
-        break;
-      case SDLK_X:
-        keyboard[0x0] = 0;
-        break;
-      case SDLK_C:
-        keyboard[0xB] = 0;
-        break;
-      case SDLK_V:
-        keyboard[0xF] = 0;
-        break;
-      default:;
-      }
-    }
+    input_handle_event(&input, &event);
   }
 }
 
 void render(SDL_Renderer *renderer) {
-  SDL_Texture *screen_texture =
-      get_screen_texture(renderer, SCREEN_W, SCREEN_H);
+  int output_w;
+  int output_h;
+  SDL_GetCurrentRenderOutputSize(renderer, &output_w, &output_h);
+  if (!update_screen_texture(renderer, output_w, output_h)) {
+    return;
+  }
+
+  // integer scaling leaves a border, keep the picture centered
+  SDL_FRect target = {(output_w - scaler.width) / 2,
+                      (output_h - scaler.height) / 2, scaler.width,
+                      scaler.height};
 
   SDL_RenderClear(renderer);
-  SDL_RenderTexture(renderer, screen_texture, NULL, NULL);
+  SDL_RenderTexture(renderer, screen_texture, NULL, &target);
   SDL_RenderPresent(renderer);
 }
 
 void close_sdl(SDL_Window *window, SDL_Renderer *renderer) {
+  if (screen_texture) {
+    SDL_DestroyTexture(screen_texture);
+    scale_free(&scaler);
+    screen_texture = NULL;
+  }
+
   if (renderer) {
     SDL_DestroyRenderer(renderer);
   }
@@ -252,488 +400,55 @@ void close_sdl(SDL_Window *window, SDL_Renderer *renderer) {
     SDL_DestroyWindow(window);
   }
 
-  SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS);
+  input_close(&input);
+  SDL_QuitSubSystem(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_EVENTS |
+                    SDL_INIT_GAMEPAD);
   SDL_Quit();
 }
 
-void set_pixel_color(SDL_Surface *surface, const int x, const int y,
-                     const uint32_t color) {
-  if (surface == NULL) {
-    return;
-  }
-
-  Uint8 *pixel = (Uint8 *)surface->pixels;
-  pixel += (y * surface->pitch) + (x * sizeof(uint32_t));
-  *((uint32_t *)pixel) = color;
-}
-
-SDL_Texture *get_screen_texture(SDL_Renderer *renderer, const int screen_w,
-                                const int screen_h) {
-  SDL_Surface *screen_surface =
-      SDL_CreateSurface(SCREEN_W, SCREEN_H, SDL_PIXELFORMAT_RGBA8888);
-  for (int i = 0; i < SCREEN_H; ++i) {
-    for (int j = 0; j < SCREEN_W; ++j) {
-      uint32_t pixel_color = screen_state[i][j] ? 0xFFFFFFFF : 0x0;
-      set_pixel_color(screen_surface, j, i, pixel_color);
-    }
-  }
-
-  return SDL_CreateTextureFromSurface(renderer, screen_surface);
-}
-
-void init_emulator(char *rom_name) {
-  srand(time(NULL));
-  memset(memory, 0, MEMSIZE);
-  memset(v, 0, 16);
-  memset(keyboard, false, 17);
-  index_register = 0;
-
-  memcpy(memory + FONT_MEMORY_LOCATION, fonts,
-         FONTSET_SIZE); // copy fonts into mem
-  program_counter = 0x200;
-
-  load_program(rom_name != NULL ? rom_name : "roms/IBM_Logo.ch8");
-
-  last_time = SDL_GetPerformanceCounter();
-  frequency = (double)SDL_GetPerformanceFrequency();
-}
-
-void load_program(char *program_file_path) {
-  FILE *program_file = fopen(program_file_path, "rb");
-  if (program_file == NULL) {
-    printf("error while opening file\n");
-    return;
-  }
-
-  fseek(program_file, 0, SEEK_END);
-  int fsize = ftell(program_file);
-  fseek(program_file, 0, SEEK_SET);
-
-  if (fsize == -1) {
-    printf("error while reading the file size\n");
-    return;
-  }
-
-  char *program = malloc(fsize + 1);
-  if (program == NULL) {
-    printf("error while allocating program memory\n");
-    fclose(program_file);
-
-    return;
-  }
-
-  fread(program, fsize, 1, program_file);
-  int res = ferror(program_file);
-  if (res != 0) {
-    printf("error while reading the file\n");
-    free(program);
-    fclose(program_file);
-
-    return;
-  }
-
-  fclose(program_file);
-
-  memcpy(memory + 0x200, program, fsize);
-  free(program);
-
-  printf("the program has been loaded correctly\n");
-}
-
-uint8_t *byte_to_bits(const uint8_t byte, uint8_t *bits_arr) {
-  uint8_t mask = 0x80;
-
-  for (int i = 0; i < 8; ++i) {
-    bits_arr[i] = (byte & mask) != 0;
-    mask >>= 1;
-  }
-
-  return bits_arr;
-}
-
-// run fetch, decode and execute
-bool execute_cycle() {
-  bool should_update_screen = false;
-  uint16_t op_code = ((uint8_t)memory[program_counter] << 8) |
-                     (uint8_t)memory[program_counter + 1];
-
-  program_counter += 2;
-
-  uint8_t op_type = (op_code & 0xF000) >> 12;
-  uint8_t x = (op_code & 0x0F00) >> 8;
-  uint8_t y = (op_code & 0x00F0) >> 4;
-  uint8_t n = op_code & 0x000F;
-  uint8_t nn = op_code & 0x00FF;
-  uint16_t nnn = op_code & 0x0FFF;
-
-  switch (op_type) {
-  case 0x0:
-    if (nn == 0xE0) {
-      op_clear_screen();
-      should_update_screen = true;
-    } else if (nn == 0xEE) {
-      op_return_subroutine();
-    }
-    break;
-  case 0x1:
-    op_jump(nnn);
-    break;
-  case 0x2:
-    op_call_subroutine(nnn);
-    break;
-  case 0x3:
-    op_skip_eq_reg_num(x, nn);
-    break;
-  case 0x4:
-    op_skip_not_eq_reg_num(x, nn);
-    break;
-  case 0x5:
-    op_skip_eq_reg(x, y);
-    break;
-  case 0x6:
-    op_set_register(x, nn);
-    break;
-  case 0x7:
-    op_add_to_register(x, nn);
-    break;
-  case 0x8:
-    switch (n) {
-    case 0x0:
-      op_set(x, y);
-      break;
-    case 0x1:
-      op_binary_or(x, y);
-      break;
-    case 0x2:
-      op_binary_and(x, y);
-      break;
-    case 0x3:
-      op_binary_xor(x, y);
-      break;
-    case 0x4:
-      op_add_registers(x, y);
-      break;
-    case 0x5:
-      op_vx_minus_vy(x, y);
-      break;
-    case 0x6:
-      op_shift_right(x, y);
-      break;
-    case 0x7:
-      op_vy_minus_vx(x, y);
-      break;
-    case 0xE:
-      op_shift_left(x, y);
-      break;
-    default:;
-    }
-    break;
-  case 0x9:
-    op_skip_not_eq_reg(x, y);
-    break;
-  case 0xA:
-    op_set_index(nnn);
-    break;
-  case 0xB:
-    op_jump_with_offset(x, nn, nnn);
-    break;
-  case 0xC:
-    op_random(x, nn);
-    break;
-  case 0xD:
-    op_draw_sprite(x, y, n);
-    should_update_screen = true;
-    break;
-  case 0xE:
-    switch (nn) {
-    case 0x9E:
-      op_skip_if_key(x);
-      break;
-    case 0xA1:
-      op_skip_if_not_key(x);
-      break;
-    default:;
-    }
-    break;
-  case 0xF:
-    switch (nn) {
-    case 0x07:
-      op_set_reg_to_delay_timer(x);
-      break;
-    case 0x15:
-      op_set_delay_timer_to_reg(x);
-      break;
-    case 0x18:
-      op_set_sound_timer_to_reg(x);
-      break;
-    case 0x29:
-      op_set_font_char(x);
-      break;
-    case 0x33:
-      op_decode_to_decimal(x);
-      break;
-    case 0x55:
-      op_store_memory(x);
-      break;
-    case 0x65:
-      op_load_memory(x);
-      break;
-    case 0x0A:
-      op_get_key(x);
-      break;
-    case 0x1E:
-      op_add_to_index(x);
-      break;
-    default:;
-    }
-    // exit(1);
-    break;
-  default:
-    printf("undefined instruction: %x\n", op_type);
-    // exit(1);
-  }
-
-  return should_update_screen;
-}
-
-void op_jump(uint16_t dst) { program_counter = dst; }
-
-void op_set_register(uint8_t reg, uint8_t value) { v[reg] = value; }
-
-void op_add_to_register(uint8_t reg, uint8_t value) { v[reg] += value; }
-
-void op_set_index(uint16_t value) { index_register = value; }
-
-void op_draw_sprite(uint8_t reg1, uint8_t reg2, uint8_t n) {
-  int target_pos_x = v[reg1] & (SCREEN_W - 1);
-  int target_pos_y = v[reg2] & (SCREEN_H - 1);
-  // int target_pos_x = v[reg1];
-  // int target_pos_y = v[reg2];
-  v[0xf] = 0;
-
-  uint8_t *sprite = memory + index_register;
-  for (int i = 0; i < n; ++i) {
-    int effective_pos_y = target_pos_y + i;
-    if (effective_pos_y >= SCREEN_H) {
-      ++sprite;
-      continue;
+// the texture has the size of the scaled screen and is recreated when the
+// window size asks for another factor. only the rows the scaler rewrote are
+// uploaded.
+bool update_screen_texture(SDL_Renderer *renderer, const int output_w,
+                           const int output_h) {
+  bool resized = screen_texture == NULL ||
+                 !scale_fits(&scaler, output_w, output_h);
+  if (resized) {
+    if (screen_texture) {
+      SDL_DestroyTexture(screen_texture);
+      scale_free(&scaler);
     }
 
-    uint8_t sprite_bits[8];
-    byte_to_bits(*sprite, sprite_bits);
-
-    for (int j = 0; j < 8; ++j) {
-      int effective_pos_x = target_pos_x + j;
-      if (effective_pos_x >= SCREEN_W) {
-        break;
-      }
-
-      bool current_pixel_state = screen_state[effective_pos_y][effective_pos_x];
-      screen_state[effective_pos_y][effective_pos_x] ^= sprite_bits[j];
-
-      if (current_pixel_state &&
-          !screen_state[effective_pos_y][effective_pos_x]) {
-        v[0xf] = 1;
-      }
+    screen_texture = NULL;
+    if (!scale_init(&scaler, scale_mode, output_w, output_h)) {
+      return false;
     }
 
-    ++sprite;
-  }
-}
-
-void op_clear_screen() {
-  for (int i = 0; i < SCREEN_H; ++i) {
-    for (int j = 0; j < SCREEN_W; ++j) {
-      screen_state[i][j] = 0x0;
+    screen_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGB565,
+                                       SDL_TEXTUREACCESS_STREAMING,
+                                       scaler.width, scaler.height);
+    if (screen_texture == NULL) {
+      printf("could not create the screen texture\n");
+      scale_free(&scaler);
+      return false;
     }
-  }
-}
-
-void op_skip_eq_reg_num(uint8_t reg, uint8_t value) {
-  if (v[reg] == value) {
-    program_counter += 2;
-  }
-}
-void op_skip_not_eq_reg_num(uint8_t reg, uint8_t value) {
-  if (v[reg] != value) {
-    program_counter += 2;
-  }
-}
-
-void op_skip_eq_reg(uint8_t reg1, uint8_t reg2) {
-  if (v[reg1] == v[reg2]) {
-    program_counter += 2;
-  }
-}
-
-void op_skip_not_eq_reg(uint8_t reg1, uint8_t reg2) {
-  if (v[reg1] != v[reg2]) {
-    program_counter += 2;
-  }
-}
-
-void op_return_subroutine() {
-  int16_t next_action = stack_pop(&functions_stack);
-  program_counter = next_action;
-}
-
-void op_call_subroutine(uint16_t function) {
-  stack_push(&functions_stack, program_counter);
-  program_counter = function;
-}
-
-void op_set(uint8_t reg1, uint8_t reg2) { v[reg1] = v[reg2]; }
-
-void op_binary_or(uint8_t reg1, uint8_t reg2) {
-  v[reg1] = v[reg1] | v[reg2];
-  v[0xF] = 0;
-}
-
-void op_binary_and(uint8_t reg1, uint8_t reg2) {
-  v[reg1] = v[reg1] & v[reg2];
-  v[0xF] = 0;
-}
-
-void op_binary_xor(uint8_t reg1, uint8_t reg2) {
-  v[reg1] = v[reg1] ^ v[reg2];
-  v[0xF] = 0;
-}
-
-void op_add_registers(uint8_t reg1, uint8_t reg2) {
-  uint8_t a = v[reg1];
-  uint8_t b = v[reg2];
-  uint8_t c = a + b;
-
-  v[reg1] = c;
-  v[0xF] = c < a ? 1 : 0;
-}
-
-void op_vx_minus_vy(uint8_t reg1, uint8_t reg2) {
-  uint8_t vx = v[reg1];
-  uint8_t vy = v[reg2];
-  uint8_t flag = (vx >= vy) ? 1 : 0;
-
-  v[reg1] = vx - vy;
-  v[0xF] = flag;
-}
-
-void op_vy_minus_vx(uint8_t reg1, uint8_t reg2) {
-  uint8_t vx = v[reg1];
-  uint8_t vy = v[reg2];
-  uint8_t flag = (vy >= vx) ? 1 : 0;
-
-  v[reg1] = vy - vx;
-  v[0xF] = flag;
-}
-
-void op_shift_right(uint8_t reg1, uint8_t reg2) {
-  if (legacy_mode) {
-    uint8_t shifted_bit = v[reg2] & 0x01;
-    v[reg1] = v[reg2] >> 1;
-    v[0xf] = shifted_bit;
-    return;
-  }
-
-  uint8_t shifted_bit = v[reg1] & 0x01;
-  v[reg1] >>= 1;
-  v[0xf] = shifted_bit;
-}
-
-void op_shift_left(uint8_t reg1, uint8_t reg2) {
-  if (legacy_mode) {
-    uint8_t shifted_bit = (v[reg2] & 0x80) >> 7;
-    v[reg1] = v[reg2] << 1;
-    v[0xf] = shifted_bit;
-    return;
-  }
-
-  uint8_t shifted_bit = (v[reg1] & 0x80) >> 7;
-  v[reg1] <<= 1;
-  v[0xf] = shifted_bit;
-}
-
-void op_jump_with_offset(uint8_t reg1, uint8_t nn, uint16_t nnn) {
-  if (legacy_mode) {
-    program_counter = nnn;
-    program_counter += v[0];
-    return;
-  }
 
-  program_counter = nnn;
-  program_counter += v[reg1];
-}
-
-void op_random(uint8_t reg1, uint8_t nn) { v[reg1] = (rand() % 255) & nn; }
-
-void op_skip_if_key(uint8_t reg) {
-  uint8_t required_key = v[reg];
-  if (keyboard[required_key]) {
-    program_counter += 2;
-  }
-}
-
-void op_skip_if_not_key(uint8_t reg) {
-  uint8_t required_key = v[reg];
-  if (!keyboard[required_key]) {
-    program_counter += 2;
+    SDL_SetTextureScaleMode(screen_texture, SDL_SCALEMODE_NEAREST);
   }
-}
-
-void op_set_reg_to_delay_timer(uint8_t reg) { v[reg] = delay_timer; }
 
-void op_set_delay_timer_to_reg(uint8_t reg) { delay_timer = v[reg]; }
-
-void op_set_sound_timer_to_reg(uint8_t reg) { audio_timer = v[reg]; }
-
-void op_add_to_index(uint8_t reg) { index_register += v[reg]; }
-
-void op_get_key(uint8_t reg) {
-  bool pressed = false;
-  for (int i = 0; i < 17; ++i) {
-    if (keyboard[i]) {
-      pressed = true;
-      v[reg] = i;
-      break;
+  // the scaler writes straight into the locked rows, the texture memory is
+  // the only copy of the scaled screen
+  int top;
+  int bottom;
+  if (scale_begin(&scaler, &top, &bottom)) {
+    SDL_Rect rows = {0, top, scaler.width, bottom - top};
+    void *pixels;
+    int pitch;
+    if (SDL_LockTexture(screen_texture, &rows, &pixels, &pitch)) {
+      scale_write(&scaler, pixels, pitch);
+      SDL_UnlockTexture(screen_texture);
     }
   }
 
-  if (!pressed) {
-    program_counter -= 2;
-  }
-}
-
-void op_set_font_char(uint8_t reg) {
-  index_register = (v[reg] * 5) + FONT_MEMORY_LOCATION;
-}
-
-void op_decode_to_decimal(uint8_t reg) {
-  uint8_t val = v[reg];
-
-  memory[index_register + 2] = val % 10;
-  val /= 10;
-
-  memory[index_register + 1] = val % 10;
-  val /= 10;
-
-  memory[index_register] = val;
-}
-
-void op_store_memory(uint8_t reg) {
-  for (int i = 0; i <= reg; ++i) {
-    memory[index_register + i] = v[i];
-  }
-
-  if (legacy_mode) {
-    index_register += reg + 1;
-  }
-}
-
-void op_load_memory(uint8_t reg) {
-  for (int i = 0; i <= reg; ++i) {
-    v[i] = memory[index_register + i];
-  }
-
-  if (legacy_mode) {
-    index_register += reg + 1;
-  }
+  return true;
 }
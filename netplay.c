@@ -0,0 +1,245 @@
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netinet/in.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chip8.h"
+#include "netplay.h"
+
+#define NO_ROLLBACK INT64_MAX
+
+static uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+// the link simulation has its own generator, the machine one must only be
+// advanced by the rom or both peers would drift apart
+static bool should_drop(Netplay *np) {
+  if (np->loss_percent <= 0) {
+    return false;
+  }
+
+  np->loss_state = mix_hash(np->loss_state);
+  return (int)(np->loss_state % 100) < np->loss_percent;
+}
+
+static void send_now(Netplay *np, const NetPacket *packet) {
+  sendto(np->socket_fd, packet, sizeof(NetPacket), 0,
+         (struct sockaddr *)&np->peer, sizeof(np->peer));
+}
+
+static void flush_outgoing(Netplay *np) {
+  uint64_t now = now_ns();
+  int kept = 0;
+
+  for (int i = 0; i < np->outgoing_count; ++i) {
+    if (np->outgoing[i].release_time <= now) {
+      send_now(np, &np->outgoing[i].packet);
+    } else {
+      np->outgoing[kept++] = np->outgoing[i];
+    }
+  }
+
+  np->outgoing_count = kept;
+}
+
+// every packet carries all our inputs the peer has not confirmed yet, so a
+// lost packet is repaired by the next one
+static void send_inputs(Netplay *np) {
+  NetPacket packet;
+  memset(&packet, 0, sizeof(packet));
+  packet.magic = NETPLAY_MAGIC;
+  packet.session = np->session;
+  packet.first_frame = np->remote_ack + 1;
+  packet.ack_frame = np->remote_frame;
+  packet.count = np->frame - packet.first_frame;
+
+  for (int i = 0; i < packet.count; ++i) {
+    int64_t frame = packet.first_frame + i;
+    packet.inputs[i] = np->local_inputs[frame % NETPLAY_HISTORY];
+  }
+
+  if (should_drop(np)) {
+    return;
+  }
+
+  if (np->latency_ms <= 0 || np->outgoing_count == NETPLAY_OUTGOING) {
+    send_now(np, &packet);
+    return;
+  }
+
+  DelayedPacket *delayed = &np->outgoing[np->outgoing_count++];
+  delayed->release_time = now_ns() + np->latency_ms * 500000ULL;
+  delayed->packet = packet;
+}
+
+static void receive_inputs(Netplay *np) {
+  NetPacket packet;
+
+  while (recv(np->socket_fd, &packet, sizeof(packet), 0) ==
+         sizeof(NetPacket)) {
+    if (packet.magic != NETPLAY_MAGIC || packet.count > NETPLAY_REDUNDANCY) {
+      continue;
+    }
+
+    if (packet.session != np->session) {
+      printf("netplay: peer runs a different rom, ignoring it\n");
+      continue;
+    }
+
+    if (packet.ack_frame > np->remote_ack) {
+      np->remote_ack = packet.ack_frame;
+    }
+
+    for (int i = 0; i < packet.count; ++i) {
+      int64_t frame = packet.first_frame + i;
+      if (frame != np->remote_frame + 1) {
+        continue;
+      }
+
+      // an input for a frame we already ran on a guess: if the guess was
+      // wrong everything from that frame on has to be simulated again
+      uint16_t *input = &np->remote_inputs[frame % NETPLAY_HISTORY];
+      if (frame < np->frame && *input != packet.inputs[i] &&
+          frame < np->rollback_from) {
+        np->rollback_from = frame;
+      }
+
+      *input = packet.inputs[i];
+      np->remote_frame = frame;
+    }
+  }
+}
+
+static bool simulate(Netplay *np, int64_t frame) {
+  uint16_t remote = 0;
+  if (frame <= np->remote_frame) {
+    remote = np->remote_inputs[frame % NETPLAY_HISTORY];
+  } else if (np->remote_frame >= 0) {
+    // predict that the peer keeps holding the same keys
+    remote = np->remote_inputs[np->remote_frame % NETPLAY_HISTORY];
+    np->remote_inputs[frame % NETPLAY_HISTORY] = remote;
+  } else {
+    np->remote_inputs[frame % NETPLAY_HISTORY] = 0;
+  }
+
+  // the keys are part of the snapshot, FX0A needs the edges between frames
+  save_machine(&np->snapshots[frame % NETPLAY_HISTORY]);
+  set_keys((np->local_inputs[frame % NETPLAY_HISTORY] & np->local_keys_mask) |
+           (remote & np->remote_keys_mask));
+  return run_frame();
+}
+
+bool netplay_start(Netplay *np, int local_port, int peer_port,
+                   int latency_ms, int loss_percent) {
+  memset(np, 0, sizeof(Netplay));
+  np->latency_ms = latency_ms;
+  np->loss_percent = loss_percent;
+  np->loss_state = now_ns();
+  np->remote_frame = -1;
+  np->remote_ack = -1;
+  np->rollback_from = NO_ROLLBACK;
+
+  np->socket_fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (np->socket_fd == -1) {
+    printf("could not create the netplay socket\n");
+    return false;
+  }
+
+  struct sockaddr_in local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  local.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  local.sin_port = htons(local_port);
+
+  if (bind(np->socket_fd, (struct sockaddr *)&local, sizeof(local)) == -1) {
+    printf("could not bind netplay port %d\n", local_port);
+    close(np->socket_fd);
+    return false;
+  }
+
+  fcntl(np->socket_fd, F_SETFL, O_NONBLOCK);
+
+  np->peer.sin_family = AF_INET;
+  np->peer.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  np->peer.sin_port = htons(peer_port);
+
+  // both sides start from the freshly loaded rom with the same randoms
+  seed_random(NETPLAY_SEED);
+  np->session = memory_hash;
+
+  // the ports give both peers the same view of who owns which keys
+  bool left = local_port < peer_port;
+  np->local_keys_mask = left ? NETPLAY_LEFT_KEYS : NETPLAY_RIGHT_KEYS;
+  np->remote_keys_mask = left ? NETPLAY_RIGHT_KEYS : NETPLAY_LEFT_KEYS;
+
+  printf("netplay on port %d, peer on port %d, playing the %s keys\n",
+         local_port, peer_port, left ? "left" : "right");
+  return true;
+}
+
+// run the next frame with the local keys, rolling back first if the peer's
+// inputs proved a prediction wrong. returns true when the screen may have
+// changed. when too far ahead of the peer the frame is not run.
+bool netplay_advance(Netplay *np, uint16_t local_keys) {
+  bool screen_changed = false;
+
+  flush_outgoing(np);
+  receive_inputs(np);
+
+  if (np->rollback_from < np->frame) {
+    int64_t depth = np->frame - np->rollback_from;
+    load_machine(&np->snapshots[np->rollback_from % NETPLAY_HISTORY]);
+    for (int64_t frame = np->rollback_from; frame < np->frame; ++frame) {
+      simulate(np, frame);
+    }
+
+    ++np->rollbacks;
+    np->resimulated_frames += depth;
+    if (depth > np->max_rollback) {
+      np->max_rollback = depth;
+    }
+
+    screen_changed = true;
+  }
+  np->rollback_from = NO_ROLLBACK;
+
+  bool too_far_ahead = np->frame - np->remote_frame > NETPLAY_MAX_AHEAD ||
+                       np->frame - np->remote_ack > NETPLAY_REDUNDANCY;
+  if (too_far_ahead) {
+    ++np->stalls;
+  } else {
+    np->local_inputs[np->frame % NETPLAY_HISTORY] =
+        local_keys & np->local_keys_mask;
+    if (simulate(np, np->frame)) {
+      screen_changed = true;
+    }
+    ++np->frame;
+  }
+
+  send_inputs(np);
+
+  return screen_changed;
+}
+
+void netplay_print_stats(Netplay *np) {
+  printf("netplay: %" PRId64 " frames, %" PRIu64 " rollbacks, %" PRIu64
+         " frames simulated again, deepest rollback %" PRId64
+         " frames, %" PRIu64 " stalls\n",
+         np->frame, np->rollbacks, np->resimulated_frames, np->max_rollback,
+         np->stalls);
+}
+
+void netplay_stop(Netplay *np) {
+  netplay_print_stats(np);
+  close(np->socket_fd);
+}
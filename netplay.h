@@ -0,0 +1,71 @@
+#ifndef NETPLAY_H
+#define NETPLAY_H
+
+#include "chip8.h"
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NETPLAY_MAGIC 0x4E503843 // "C8PN"
+#define NETPLAY_HISTORY 64       // frames of snapshots, power of two
+#define NETPLAY_MAX_AHEAD 20     // predicted frames before waiting on the peer
+#define NETPLAY_REDUNDANCY 32    // inputs resent in every packet
+#define NETPLAY_OUTGOING 128     // packets held back by the simulated latency
+#define NETPLAY_SEED 0xC8        // both peers must draw the same randoms
+
+// each player owns half of the keypad: the left two columns (1 2 4 5 7 8 A 0)
+// go to the peer on the lower port, the right two (3 C 6 D 9 E B F) to the
+// other one. two player roms like pong put each side in one half.
+#define NETPLAY_LEFT_KEYS 0x05B7
+#define NETPLAY_RIGHT_KEYS 0xFA48
+
+// both peers run on the same machine, so packets are sent as raw structs
+typedef struct net_packet {
+  uint32_t magic;
+  uint64_t session; // memory hash after loading, differs for other roms
+  int64_t first_frame;
+  int64_t ack_frame; // last frame of our inputs the sender has
+  uint8_t count;
+  uint16_t inputs[NETPLAY_REDUNDANCY];
+} NetPacket;
+
+typedef struct delayed_packet {
+  uint64_t release_time; // nanoseconds, monotonic clock
+  NetPacket packet;
+} DelayedPacket;
+
+typedef struct netplay {
+  int socket_fd;
+  struct sockaddr_in peer;
+  uint64_t session;
+  uint16_t local_keys_mask; // keys this player owns
+  uint16_t remote_keys_mask;
+
+  // link simulation, applied to what we send
+  int latency_ms; // round trip time, half of it is added to every packet
+  int loss_percent;
+  uint64_t loss_state;
+  DelayedPacket outgoing[NETPLAY_OUTGOING];
+  int outgoing_count;
+
+  int64_t frame;        // next frame to simulate
+  int64_t remote_frame; // last frame with a confirmed remote input
+  int64_t remote_ack;   // last frame of our inputs the peer confirmed
+  int64_t rollback_from;
+  uint16_t local_inputs[NETPLAY_HISTORY];
+  uint16_t remote_inputs[NETPLAY_HISTORY]; // confirmed or predicted
+  MachineState snapshots[NETPLAY_HISTORY]; // state before each frame
+
+  uint64_t rollbacks;
+  uint64_t resimulated_frames;
+  int64_t max_rollback;
+  uint64_t stalls;
+} Netplay;
+
+bool netplay_start(Netplay *np, int local_port, int peer_port,
+                   int latency_ms, int loss_percent);
+bool netplay_advance(Netplay *np, uint16_t local_keys);
+void netplay_print_stats(Netplay *np);
+void netplay_stop(Netplay *np);
+
+#endif // !NETPLAY_H
@@ -0,0 +1,284 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "chip8.h"
+#include "record.h"
+
+static bool pixel_at(const PackedFrame *frame, int x, int y) {
+  return (frame->rows[y] >> (SCREEN_W - 1 - x)) & 1;
+}
+
+// expand the 1 bit frame into one byte per output pixel
+static void expand_frame(Recorder *rec, const PackedFrame *frame,
+                         int channels) {
+  int out_w = SCREEN_W * rec->scale;
+  uint8_t *out = rec->pixels;
+
+  for (int y = 0; y < SCREEN_H; ++y) {
+    uint8_t *row = out;
+    for (int x = 0; x < SCREEN_W; ++x) {
+      uint8_t color = pixel_at(frame, x, y) ? 0xFF : 0x0;
+      memset(out, color, rec->scale * channels);
+      out += rec->scale * channels;
+    }
+
+    for (int i = 1; i < rec->scale; ++i) {
+      memcpy(out, row, out_w * channels);
+      out += out_w * channels;
+    }
+  }
+}
+
+static void write_y4m(Recorder *rec, const PackedFrame *frame) {
+  size_t size = SCREEN_W * SCREEN_H * rec->scale * rec->scale;
+
+  // y4m has a fixed frame rate, repeat the previous picture for the frames
+  // that were deduplicated by the producer
+  if (rec->has_written) {
+    uint64_t repeats = frame->frame - rec->last_written.frame - 1;
+    for (uint64_t i = 0; i < repeats; ++i) {
+      fputs("FRAME\n", rec->file);
+      fwrite(rec->pixels, size, 1, rec->file);
+    }
+  }
+
+  expand_frame(rec, frame, 1);
+  fputs("FRAME\n", rec->file);
+  fwrite(rec->pixels, size, 1, rec->file);
+}
+
+static void write_ppm(Recorder *rec, const PackedFrame *frame) {
+  char file_name[300];
+  snprintf(file_name, sizeof(file_name), "%s_%08" PRIu64 ".ppm", rec->path,
+           frame->frame);
+
+  FILE *file = fopen(file_name, "wb");
+  if (file == NULL) {
+    printf("could not open %s\n", file_name);
+    return;
+  }
+
+  int w = SCREEN_W * rec->scale;
+  int h = SCREEN_H * rec->scale;
+  expand_frame(rec, frame, 3);
+  fprintf(file, "P6\n%d %d\n255\n", w, h);
+  fwrite(rec->pixels, w * h * 3, 1, file);
+  fclose(file);
+}
+
+// record layout: frame number (u64), runs count (u16), runs (u16 each).
+// runs alternate between off and on pixels, starting with off, scanning the
+// screen row by row. integers are in host byte order.
+static void write_rle(Recorder *rec, const PackedFrame *frame) {
+  uint16_t runs[SCREEN_W * SCREEN_H + 1];
+  uint16_t runs_count = 0;
+  uint16_t run = 0;
+  bool current = false;
+
+  for (int y = 0; y < SCREEN_H; ++y) {
+    for (int x = 0; x < SCREEN_W; ++x) {
+      if (pixel_at(frame, x, y) != current) {
+        runs[runs_count++] = run;
+        current = !current;
+        run = 0;
+      }
+
+      ++run;
+    }
+  }
+
+  runs[runs_count++] = run;
+
+  fwrite(&frame->frame, sizeof(frame->frame), 1, rec->file);
+  fwrite(&runs_count, sizeof(runs_count), 1, rec->file);
+  fwrite(runs, sizeof(uint16_t), runs_count, rec->file);
+}
+
+static void write_frame(Recorder *rec, const PackedFrame *frame) {
+  switch (rec->format) {
+  case RECORD_Y4M:
+    write_y4m(rec, frame);
+    break;
+  case RECORD_PPM:
+    write_ppm(rec, frame);
+    break;
+  case RECORD_RLE:
+    write_rle(rec, frame);
+    break;
+  }
+
+  rec->last_written = *frame;
+  rec->has_written = true;
+}
+
+static void *writer_thread(void *arg) {
+  Recorder *rec = arg;
+
+  while (true) {
+    uint64_t tail =
+        atomic_load_explicit(&rec->queue_tail, memory_order_relaxed);
+    uint64_t head =
+        atomic_load_explicit(&rec->queue_head, memory_order_acquire);
+
+    if (tail == head) {
+      if (atomic_load(&rec->stopping)) {
+        break;
+      }
+
+      pthread_mutex_lock(&rec->lock);
+      if (atomic_load(&rec->queue_head) == tail &&
+          !atomic_load(&rec->stopping)) {
+        pthread_cond_wait(&rec->wakeup, &rec->lock);
+      }
+      pthread_mutex_unlock(&rec->lock);
+
+      continue;
+    }
+
+    write_frame(rec, &rec->queue[tail & (RECORD_QUEUE_SIZE - 1)]);
+    atomic_store_explicit(&rec->queue_tail, tail + 1, memory_order_release);
+  }
+
+  return NULL;
+}
+
+static void push_frame(Recorder *rec, const PackedFrame *frame) {
+  uint64_t head = atomic_load_explicit(&rec->queue_head, memory_order_relaxed);
+  uint64_t tail = atomic_load_explicit(&rec->queue_tail, memory_order_acquire);
+  if (head - tail >= RECORD_QUEUE_SIZE) {
+    ++rec->dropped;
+    return;
+  }
+
+  rec->queue[head & (RECORD_QUEUE_SIZE - 1)] = *frame;
+  atomic_store_explicit(&rec->queue_head, head + 1, memory_order_release);
+
+  pthread_mutex_lock(&rec->lock);
+  pthread_cond_signal(&rec->wakeup);
+  pthread_mutex_unlock(&rec->lock);
+
+  rec->last_pushed = *frame;
+  rec->has_pushed = true;
+}
+
+bool record_parse_format(const char *name, RecordFormat *format) {
+  if (strcmp(name, "y4m") == 0) {
+    *format = RECORD_Y4M;
+  } else if (strcmp(name, "ppm") == 0) {
+    *format = RECORD_PPM;
+  } else if (strcmp(name, "rle") == 0) {
+    *format = RECORD_RLE;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+bool record_start(Recorder *rec, const char *path, RecordFormat format,
+                  int scale) {
+  memset(rec, 0, sizeof(Recorder));
+  rec->format = format;
+  rec->scale = scale < 1 ? 1 : scale > RECORD_MAX_SCALE ? RECORD_MAX_SCALE
+                                                        : scale;
+  snprintf(rec->path, sizeof(rec->path), "%s", path);
+
+  int w = SCREEN_W * rec->scale;
+  int h = SCREEN_H * rec->scale;
+  if (format != RECORD_RLE) {
+    rec->pixels = malloc(w * h * 3);
+    if (rec->pixels == NULL) {
+      printf("error while allocating recording memory\n");
+      return false;
+    }
+  }
+
+  if (format != RECORD_PPM) {
+    rec->file = fopen(path, "wb");
+    if (rec->file == NULL) {
+      printf("could not open %s\n", path);
+      free(rec->pixels);
+      return false;
+    }
+  }
+
+  if (format == RECORD_Y4M) {
+    fprintf(rec->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 Cmono\n", w, h,
+            TIMER_FREQUENCY);
+  } else if (format == RECORD_RLE) {
+    uint16_t size[2] = {SCREEN_W, SCREEN_H};
+    fwrite("C8RLE", 5, 1, rec->file);
+    fwrite(size, sizeof(size), 1, rec->file);
+  }
+
+  pthread_mutex_init(&rec->lock, NULL);
+  pthread_cond_init(&rec->wakeup, NULL);
+  if (pthread_create(&rec->writer, NULL, writer_thread, rec) != 0) {
+    // undo everything above, the file only holds a header
+    printf("could not start the recording thread\n");
+    pthread_cond_destroy(&rec->wakeup);
+    pthread_mutex_destroy(&rec->lock);
+    if (rec->file) {
+      fclose(rec->file);
+      rec->file = NULL;
+      remove(path);
+    }
+    free(rec->pixels);
+    rec->pixels = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+// called once per shown frame. only frames that differ from the previous one
+// are queued, copying the packed rows is the only work on the caller side.
+void record_frame(Recorder *rec, uint64_t frame) {
+  PackedFrame packed;
+  packed.frame = frame;
+
+  memcpy(packed.rows, screen_rows, sizeof(packed.rows));
+
+  rec->last_seen = frame;
+  if (rec->has_pushed &&
+      memcmp(packed.rows, rec->last_pushed.rows, sizeof(packed.rows)) == 0) {
+    return;
+  }
+
+  push_frame(rec, &packed);
+}
+
+void record_stop(Recorder *rec) {
+  // let the writer know how long the last picture stayed on screen
+  if (rec->format != RECORD_PPM && rec->has_pushed &&
+      rec->last_seen != rec->last_pushed.frame) {
+    PackedFrame last = rec->last_pushed;
+    last.frame = rec->last_seen;
+    push_frame(rec, &last);
+  }
+
+  atomic_store(&rec->stopping, true);
+  pthread_mutex_lock(&rec->lock);
+  pthread_cond_signal(&rec->wakeup);
+  pthread_mutex_unlock(&rec->lock);
+  pthread_join(rec->writer, NULL);
+
+  pthread_mutex_destroy(&rec->lock);
+  pthread_cond_destroy(&rec->wakeup);
+
+  if (rec->file) {
+    fclose(rec->file);
+    rec->file = NULL;
+  }
+
+  free(rec->pixels);
+  rec->pixels = NULL;
+
+  if (rec->dropped > 0) {
+    printf("recording dropped %" PRIu64 " frames\n", rec->dropped);
+  }
+}
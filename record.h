@@ -0,0 +1,60 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+#include "chip8.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define RECORD_QUEUE_SIZE 256 // must be a power of two
+#define RECORD_MAX_SCALE 16
+
+typedef enum record_format {
+  RECORD_Y4M, // single mono yuv4mpeg2 stream at 60fps
+  RECORD_PPM, // one ppm file per changed frame, named <path>_<frame>.ppm
+  RECORD_RLE, // 1 bit frames, run length encoded, one record per change
+} RecordFormat;
+
+// the screen packed one bit per pixel, msb is the leftmost pixel
+typedef struct packed_frame {
+  uint64_t frame;
+  uint64_t rows[SCREEN_H];
+} PackedFrame;
+
+typedef struct recorder {
+  RecordFormat format;
+  int scale; // pixel size for y4m and ppm output
+  char path[256];
+  FILE *file;
+
+  // single producer / single consumer queue, the emulator pushes and the
+  // writer thread pops. the emulator never waits: frames are dropped when
+  // the queue is full.
+  PackedFrame queue[RECORD_QUEUE_SIZE];
+  _Atomic uint64_t queue_head;
+  _Atomic uint64_t queue_tail;
+  _Atomic bool stopping;
+  pthread_t writer;
+  pthread_mutex_t lock;
+  pthread_cond_t wakeup;
+
+  PackedFrame last_pushed;
+  bool has_pushed;
+  uint64_t last_seen;
+  uint64_t dropped;
+
+  // writer thread only
+  PackedFrame last_written;
+  bool has_written;
+  uint8_t *pixels;
+} Recorder;
+
+bool record_parse_format(const char *name, RecordFormat *format);
+bool record_start(Recorder *rec, const char *path, RecordFormat format,
+                  int scale);
+void record_frame(Recorder *rec, uint64_t frame);
+void record_stop(Recorder *rec);
+
+#endif // !RECORD_H
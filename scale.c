@@ -0,0 +1,300 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "chip8.h"
+#include "scale.h"
+
+#define EPX_W (SCREEN_W * 2)
+#define EPX_H (SCREEN_H * 2)
+
+static const char *mode_names[] = {"nearest", "epx", "phosphor"};
+
+// the 8 colors of every possible byte of packed pixels
+static uint16_t byte_colors[256][8];
+static uint16_t gray_colors[256];
+static bool tables_ready = false;
+
+static void init_tables() {
+  for (int byte = 0; byte < 256; ++byte) {
+    for (int bit = 0; bit < 8; ++bit) {
+      bool on = (byte >> (7 - bit)) & 1;
+      byte_colors[byte][bit] = on ? SCALE_COLOR_ON : SCALE_COLOR_OFF;
+    }
+
+    gray_colors[byte] = ((byte >> 3) << 11) | ((byte >> 2) << 5) | (byte >> 3);
+  }
+
+  tables_ready = true;
+}
+
+bool scale_parse_mode(const char *name, ScaleMode *mode) {
+  for (int i = 0; i < 3; ++i) {
+    if (strcmp(name, mode_names[i]) == 0) {
+      *mode = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static int pick_factor(ScaleMode mode, int max_width, int max_height) {
+  int source_w = mode == SCALE_EPX ? EPX_W : SCREEN_W;
+  int source_h = mode == SCALE_EPX ? EPX_H : SCREEN_H;
+  int factor_w = max_width / source_w;
+  int factor_h = max_height / source_h;
+  int factor = factor_w < factor_h ? factor_w : factor_h;
+
+  return factor < 1 ? 1 : factor;
+}
+
+bool scale_init(Scaler *scaler, ScaleMode mode, int max_width,
+                int max_height) {
+  if (!tables_ready) {
+    init_tables();
+  }
+
+  memset(scaler, 0, sizeof(Scaler));
+  scaler->mode = mode;
+  scaler->factor = pick_factor(mode, max_width, max_height);
+  scaler->width = (mode == SCALE_EPX ? EPX_W : SCREEN_W) * scaler->factor;
+  scaler->height = (mode == SCALE_EPX ? EPX_H : SCREEN_H) * scaler->factor;
+
+  scaler->line = malloc((size_t)scaler->width * 2);
+  if (scaler->line == NULL) {
+    printf("could not allocate the scaled line\n");
+    return false;
+  }
+
+  return true;
+}
+
+bool scale_fits(Scaler *scaler, int max_width, int max_height) {
+  return scaler->factor == pick_factor(scaler->mode, max_width, max_height);
+}
+
+// writes every color factor times into the scaler's line, which stays in
+// the cache while it is copied to the output rows
+static void stretch_row(const uint16_t *colors, int count, int factor,
+                        uint16_t *out) {
+  if (factor == 1) {
+    memcpy(out, colors, count * 2);
+    return;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    int copies = factor;
+#ifdef __SSE2__
+    __m128i color = _mm_set1_epi16(colors[i]);
+    for (; copies >= 8; copies -= 8) {
+      _mm_storeu_si128((__m128i *)out, color);
+      out += 8;
+    }
+#endif
+    for (; copies > 0; --copies) {
+      *out++ = colors[i];
+    }
+  }
+}
+
+// wide rows go out with streaming stores: the output is only read again by
+// the upload, so it would just push everything else out of the cache
+static void copy_row(uint16_t *out, const uint16_t *line, int count) {
+#ifdef __SSE2__
+  if (count * 2 >= SCALE_STREAM_BYTES) {
+    // up to a cache line boundary, so every 4 stores fill one line
+    int i = 0;
+    for (; i < count && ((uintptr_t)(out + i) & 63) != 0; ++i) {
+      out[i] = line[i];
+    }
+
+    for (; i + 32 <= count; i += 32) {
+      const __m128i *in = (const __m128i *)(line + i);
+      __m128i *to = (__m128i *)(out + i);
+      _mm_stream_si128(to, _mm_loadu_si128(in));
+      _mm_stream_si128(to + 1, _mm_loadu_si128(in + 1));
+      _mm_stream_si128(to + 2, _mm_loadu_si128(in + 2));
+      _mm_stream_si128(to + 3, _mm_loadu_si128(in + 3));
+    }
+
+    for (; i < count; ++i) {
+      out[i] = line[i];
+    }
+    return;
+  }
+#endif
+  memcpy(out, line, count * 2);
+}
+
+// 8 pixels per step: the byte goes to every lane, each lane keeps its own
+// bit and the compare turns it into a mask picking one of the two colors
+static void bits_to_colors(const uint64_t *words, int count,
+                           uint16_t *colors) {
+#ifdef __SSE2__
+  const __m128i bits = _mm_set_epi16(0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40,
+                                     0x80);
+  const __m128i off = _mm_set1_epi16((short)SCALE_COLOR_OFF);
+  const __m128i flip =
+      _mm_set1_epi16((short)(SCALE_COLOR_ON ^ SCALE_COLOR_OFF));
+
+  for (int i = 0; i < count; ++i) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      __m128i byte = _mm_set1_epi16((words[i] >> shift) & 0xFF);
+      __m128i on = _mm_cmpeq_epi16(_mm_and_si128(byte, bits), bits);
+      __m128i color = _mm_xor_si128(off, _mm_and_si128(on, flip));
+      _mm_storeu_si128((__m128i *)colors, color);
+      colors += 8;
+    }
+  }
+  return;
+#endif
+  for (int i = 0; i < count; ++i) {
+    for (int shift = 56; shift >= 0; shift -= 8) {
+      memcpy(colors, byte_colors[(words[i] >> shift) & 0xFF], 16);
+      colors += 8;
+    }
+  }
+}
+
+// spreads the 32 low bits to the even bits of the result
+static uint64_t spread_bits(uint64_t bits) {
+  bits &= 0xFFFFFFFF;
+  bits = (bits | (bits << 16)) & 0x0000FFFF0000FFFFULL;
+  bits = (bits | (bits << 8)) & 0x00FF00FF00FF00FFULL;
+  bits = (bits | (bits << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  bits = (bits | (bits << 2)) & 0x3333333333333333ULL;
+  bits = (bits | (bits << 1)) & 0x5555555555555555ULL;
+  return bits;
+}
+
+// pixels left and right become the even and odd pixels of two words
+static void interleave(uint64_t left, uint64_t right, uint64_t out[2]) {
+  out[0] = (spread_bits(left >> 32) << 1) | spread_bits(right >> 32);
+  out[1] = (spread_bits(left) << 1) | spread_bits(right);
+}
+
+// scale2x on a whole row at once: p is the row, a the one above, d the one
+// below, c and b the neighbours on the left and right. edges repeat the
+// border pixel.
+static void epx_row(const uint64_t rows[SCREEN_H], int y, uint64_t top[2],
+                    uint64_t bottom[2]) {
+  uint64_t p = rows[y];
+  uint64_t a = y > 0 ? rows[y - 1] : p;
+  uint64_t d = y < SCREEN_H - 1 ? rows[y + 1] : p;
+  uint64_t c = (p >> 1) | (p & (1ULL << 63));
+  uint64_t b = (p << 1) | (p & 1);
+
+  uint64_t top_left = ~(c ^ a) & (c ^ d) & (a ^ b);
+  uint64_t top_right = ~(a ^ b) & (a ^ c) & (b ^ d);
+  uint64_t bottom_left = ~(d ^ c) & (d ^ b) & (c ^ a);
+  uint64_t bottom_right = ~(b ^ d) & (b ^ a) & (d ^ c);
+
+  interleave((top_left & a) | (~top_left & p),
+             (top_right & b) | (~top_right & p), top);
+  interleave((bottom_left & c) | (~bottom_left & p),
+             (bottom_right & d) | (~bottom_right & p), bottom);
+}
+
+// the phosphor brightness of a row after one more frame, returns true when
+// it changed
+static bool fade_row(Scaler *scaler, int y, uint64_t row) {
+  bool changed = false;
+  for (int x = 0; x < SCREEN_W; ++x) {
+    uint8_t *brightness = &scaler->brightness[y][x];
+    uint8_t next = (row >> (63 - x)) & 1
+                       ? 255
+                       : (*brightness * SCALE_PHOSPHOR_DECAY) >> 8;
+    changed |= next != *brightness;
+    *brightness = next;
+  }
+
+  return changed;
+}
+
+bool scale_begin(Scaler *scaler, int *top, int *bottom) {
+  int first = SCREEN_H;
+  int last = -1;
+  for (int y = 0; y < SCREEN_H; ++y) {
+    bool changed = !scaler->has_frame || screen_rows[y] != scaler->rows[y];
+    // the brightness moves on every frame, changed or not
+    if (scaler->mode == SCALE_PHOSPHOR) {
+      changed = fade_row(scaler, y, screen_rows[y]) || !scaler->has_frame;
+    }
+
+    if (changed) {
+      first = y < first ? y : first;
+      last = y;
+    }
+  }
+
+  memcpy(scaler->rows, screen_rows, sizeof(scaler->rows));
+  scaler->has_frame = true;
+
+  if (last < first) {
+    scaler->dirty_top = scaler->dirty_bottom = 0;
+    return false;
+  }
+
+  // the neighbours above and below take part in every epx line
+  if (scaler->mode == SCALE_EPX) {
+    first = (first > 0 ? first - 1 : 0) * 2;
+    last = (last < SCREEN_H - 1 ? last + 1 : last) * 2 + 1;
+  }
+
+  scaler->dirty_top = first;
+  scaler->dirty_bottom = last + 1;
+  *top = scaler->dirty_top * scaler->factor;
+  *bottom = scaler->dirty_bottom * scaler->factor;
+  return true;
+}
+
+// the colors of a line of the image before the factor, returns their count
+static int line_colors(Scaler *scaler, int line, uint16_t *colors) {
+  switch (scaler->mode) {
+  case SCALE_EPX: {
+    uint64_t top[2];
+    uint64_t bottom[2];
+    epx_row(scaler->rows, line / 2, top, bottom);
+    bits_to_colors(line % 2 == 0 ? top : bottom, 2, colors);
+    return EPX_W;
+  }
+  case SCALE_PHOSPHOR:
+    for (int x = 0; x < SCREEN_W; ++x) {
+      colors[x] = gray_colors[scaler->brightness[line][x]];
+    }
+    return SCREEN_W;
+  default:
+    bits_to_colors(&scaler->rows[line], 1, colors);
+    return SCREEN_W;
+  }
+}
+
+void scale_write(Scaler *scaler, uint16_t *pixels, int pitch) {
+  uint16_t colors[EPX_W];
+
+  for (int line = scaler->dirty_top; line < scaler->dirty_bottom; ++line) {
+    int count = line_colors(scaler, line, colors);
+    stretch_row(colors, count, scaler->factor, scaler->line);
+
+    for (int i = 0; i < scaler->factor; ++i) {
+      copy_row(pixels, scaler->line, scaler->width);
+      pixels = (uint16_t *)((uint8_t *)pixels + pitch);
+    }
+  }
+
+#ifdef __SSE2__
+  // the streaming stores must land before the texture is unlocked
+  _mm_sfence();
+#endif
+}
+
+void scale_free(Scaler *scaler) {
+  free(scaler->line);
+  scaler->line = NULL;
+}
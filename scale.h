@@ -0,0 +1,55 @@
+#ifndef SCALE_H
+#define SCALE_H
+
+#include "chip8.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SCALE_COLOR_OFF 0x0000 // rgb565, half the bytes of argb8888 to write
+#define SCALE_COLOR_ON 0xFFFF
+#define SCALE_PHOSPHOR_DECAY 176 // brightness kept every frame, out of 256
+#define SCALE_STREAM_BYTES 1024  // rows this wide bypass the cache
+
+typedef enum scale_mode {
+  SCALE_NEAREST,  // every pixel becomes a square
+  SCALE_EPX,      // scale2x on the screen first, rounds diagonals
+  SCALE_PHOSPHOR, // nearest, pixels fade out instead of turning off
+} ScaleMode;
+
+// the screen enlarged on the cpu to an integer multiple of its size. only
+// the rows that changed since the previous frame are written again, straight
+// into the caller's buffer (a locked texture).
+typedef struct scaler {
+  ScaleMode mode;
+  int factor; // output pixels per pixel, after the epx doubling
+  int width;
+  int height;
+  uint16_t *line; // one output row, stretched once and copied factor times
+
+  // lines of the image before the factor that scale_write covers, bottom
+  // excluded. an epx image has twice the lines of the screen.
+  int dirty_top;
+  int dirty_bottom;
+
+  bool has_frame;
+  uint64_t rows[SCREEN_H]; // screen_rows as of the last scale_begin
+  uint8_t brightness[SCREEN_H][SCREEN_W];
+} Scaler;
+
+bool scale_parse_mode(const char *name, ScaleMode *mode);
+
+// picks the biggest factor that fits in max_width x max_height
+bool scale_init(Scaler *scaler, ScaleMode mode, int max_width,
+                int max_height);
+bool scale_fits(Scaler *scaler, int max_width, int max_height);
+
+// takes the current screen_rows and returns the output rows that change,
+// bottom excluded, or false when nothing does
+bool scale_begin(Scaler *scaler, int *top, int *bottom);
+
+// writes every row from scale_begin. pixels points at the top one and rows
+// are pitch bytes apart; the rows are written whole, never read.
+void scale_write(Scaler *scaler, uint16_t *pixels, int pitch);
+void scale_free(Scaler *scaler);
+
+#endif // !SCALE_H
@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chip8.h"
+#include "scale.h"
+
+#define BENCH_FRAMES 600
+
+static uint64_t now_ns() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+static void random_screen() {
+  for (int y = 0; y < SCREEN_H; ++y) {
+    screen_rows[y] = 0;
+    for (int bit = 0; bit < SCREEN_W; ++bit) {
+      screen_rows[y] = (screen_rows[y] << 1) | (rand() & 1);
+    }
+  }
+}
+
+// a 8x5 block moving one pixel per frame, like a sprite drawn and erased
+static void move_sprite(int frame) {
+  int x = frame % (SCREEN_W - 8);
+  memset(screen_rows, 0, sizeof(screen_rows));
+  for (int y = 10; y < 15; ++y) {
+    screen_rows[y] = 0xFF00000000000000ULL >> x;
+  }
+}
+
+// what the frontend does with the locked texture rows, pixels stands in for
+// the texture memory
+static void scale_into(Scaler *scaler, uint16_t *pixels) {
+  int top;
+  int bottom;
+  if (scale_begin(scaler, &top, &bottom)) {
+    scale_write(scaler, pixels + (size_t)top * scaler->width,
+                scaler->width * 2);
+  }
+}
+
+static void bench(ScaleMode mode, const char *mode_name, int width,
+                  int height, bool full_redraw) {
+  Scaler scaler;
+  if (!scale_init(&scaler, mode, width, height)) {
+    return;
+  }
+
+  uint16_t *pixels = malloc((size_t)scaler.width * scaler.height * 2);
+  if (pixels == NULL) {
+    printf("could not allocate the output\n");
+    scale_free(&scaler);
+    return;
+  }
+
+  // the first frame writes every pixel and faults the buffer in
+  scale_into(&scaler, pixels);
+
+  uint64_t total = 0;
+  uint64_t worst = 0;
+  for (int frame = 0; frame < BENCH_FRAMES; ++frame) {
+    if (full_redraw) {
+      random_screen();
+    } else {
+      move_sprite(frame);
+    }
+
+    uint64_t start = now_ns();
+    scale_into(&scaler, pixels);
+    uint64_t elapsed = now_ns() - start;
+
+    total += elapsed;
+    if (elapsed > worst) {
+      worst = elapsed;
+    }
+  }
+
+  printf("%-8s %4dx%-4d %-7s %8.1f us/frame, worst %8.1f us\n", mode_name,
+         scaler.width, scaler.height, full_redraw ? "full" : "sprite",
+         total / 1000.0 / BENCH_FRAMES, worst / 1000.0);
+  free(pixels);
+  scale_free(&scaler);
+}
+
+// microbenchmark of the cpu scaler: the whole screen changing every frame,
+// and a single moving sprite which is closer to what games do
+int main(int argc, char *argv[]) {
+  int width = 3840;
+  int height = 2160;
+  if (argc == 3) {
+    width = atoi(argv[1]);
+    height = atoi(argv[2]);
+  } else if (argc != 1) {
+    printf("usage: %s [width height]\n", argv[0]);
+    return 1;
+  }
+
+  const char *names[] = {"nearest", "epx", "phosphor"};
+  for (int mode = 0; mode < 3; ++mode) {
+    bench(mode, names[mode], width, height, true);
+    bench(mode, names[mode], width, height, false);
+  }
+
+  return 0;
+}
@@ -2,41 +2,40 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <stdlib.h>
 
 bool stack_is_empty(Stack *s) { return s->head == -1; }
 bool stack_is_full(Stack *s) { return s->head == s->max_size; }
 
-void stack_init(Stack *s, int max_size) {
+bool stack_init(Stack *s, int max_size) {
   if (max_size > MAX_ALLOWED_STACK_SIZE) {
-    printf("allocating more stack space than allowed is prohibited");
-    exit(1);
+    printf("allocating more stack space than allowed is prohibited\n");
+    return false;
   }
 
   s->max_size = max_size;
   s->head = -1;
+  return true;
 }
 
-void stack_push(Stack *s, int16_t val) {
+bool stack_push(Stack *s, int16_t val) {
   if (stack_is_full(s)) {
-    printf("stack overflow!\n");
-    exit(1);
+    return false;
   }
 
   ++s->head;
   s->data[s->head] = val;
+  return true;
 }
 
-int16_t stack_pop(Stack *s) {
+bool stack_pop(Stack *s, int16_t *val) {
   if (stack_is_empty(s)) {
-    printf("cannot pop empty stack!\n");
-    exit(1);
+    return false;
   }
 
-  int val = s->data[s->head];
+  *val = s->data[s->head];
   --s->head;
 
-  return val;
+  return true;
 }
 
 void stack_print(Stack *s) {
@@ -47,11 +46,11 @@ void stack_print(Stack *s) {
   printf("\n");
 }
 
-int16_t stack_peek(Stack *s) {
+bool stack_peek(Stack *s, int16_t *val) {
   if (stack_is_empty(s)) {
-    printf("cannot peek empty stack\n");
-    exit(1);
+    return false;
   }
 
-  return s->data[s->head];
+  *val = s->data[s->head];
+  return true;
 }
@@ -13,11 +13,13 @@ typedef struct stack {
 } Stack;
 
 void stack_print(Stack *s);
-int16_t stack_pop(Stack *s);
-int16_t stack_peek(Stack *s);
+// push, pop and peek return false on overflow or underflow and leave the
+// stack untouched, the caller decides what a fault means
+bool stack_pop(Stack *s, int16_t *val);
+bool stack_peek(Stack *s, int16_t *val);
 bool stack_is_full(Stack *s);
 bool stack_is_empty(Stack *s);
-void stack_init(Stack *s, int max_size);
-void stack_push(Stack *s, int16_t val);
+bool stack_init(Stack *s, int max_size);
+bool stack_push(Stack *s, int16_t val);
 
 #endif // !STACK_H